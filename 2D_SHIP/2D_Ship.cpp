@@ -12,12 +12,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "../common/frame_pacing.h"
+#include "../common/program_cache.h"
+#include "../common/gl_state.h"
+
 #include <iostream>
 
 using namespace std;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow* window);
+void window_refresh_callback(GLFWwindow* window);
+bool processInput(GLFWwindow* window);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -28,6 +33,14 @@ float translate_Y = 0.0;
 float scale_X = 1.0;
 float scale_Y = 1.0;
 
+// the ship only changes while a key is held: other frames are skipped and the loop waits for
+// events; TARGET_FPS > 0 caps the rate while keys are held
+const double TARGET_FPS = 60.0;
+FramePacer framePacer(TARGET_FPS);
+
+// filters the repeated colors, transforms and binds of the draw list below
+GLStateCache glState;
+
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
 "uniform mat4 transform;\n"
@@ -67,6 +80,7 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -79,43 +93,53 @@ int main()
 
     // build and compile our shader program
     // ------------------------------------
-    // vertex shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    // check for shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    // check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+    // the linked program is cached on disk, so later launches only compile after a source or driver change
+    double shaderStart = glfwGetTime();
+    ProgramCache programCache;
+    std::string programKey = programCache.makeKey(vertexShaderSource, fragmentShaderSource);
+    unsigned int shaderProgram = programCache.load(programKey);
+    if (shaderProgram == 0)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-    // link shaders
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    // check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        // vertex shader
+        unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+        glCompileShader(vertexShader);
+        // check for shader compile errors
+        int success;
+        char infoLog[512];
+        glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+        // fragment shader
+        unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
+        glCompileShader(fragmentShader);
+        // check for shader compile errors
+        glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+        // link shaders
+        shaderProgram = glCreateProgram();
+        glAttachShader(shaderProgram, vertexShader);
+        glAttachShader(shaderProgram, fragmentShader);
+        programCache.prepare(shaderProgram);
+        glLinkProgram(shaderProgram);
+        // check for linking errors
+        glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        programCache.store(programKey, shaderProgram, glfwGetTime() - shaderStart);
     }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -3238,11 +3262,16 @@ int main()
     {
         // input
         // -----
-        processInput(window);
+        bool changed = processInput(window);
+        if (!framePacer.beginFrame(changed))
+        {
+            framePacer.waitEvents(false);
+            continue;
+        }
 
         // render
         // ------
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glState.clearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
         // create transformations
@@ -3287,19 +3316,19 @@ int main()
         modelFlag = translationFlag * scaleFlag;
 
         // get matrix's uniform location and set matrix
-        glUseProgram(shaderProgram);
-        unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
+        glState.useProgram(shaderProgram);
+        int transformLoc = glState.uniformLocation(shaderProgram, "transform");
+        glState.uniformMatrix4fv(transformLoc, modelMatrix);
 
-        int colorLocation = glGetUniformLocation(shaderProgram, "colorDetail");
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.38f, 0.186f, 0.176f, 1.0f)));
+        int colorLocation = glState.uniformLocation(shaderProgram, "colorDetail");
+        glState.uniform4fv(colorLocation, glm::vec4(0.38f, 0.186f, 0.176f, 1.0f));
 
         // draw our first triangle
-        glBindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+        glState.bindVertexArray(VAO); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
         //glDrawArrays(GL_LINES, 0, 1434);
 
         //glDrawArrays(GL_LINE_STRIP, 0, 391);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.086f, 0.11f, 0.173f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.086f, 0.11f, 0.173f, 1.0f));
 
 
         //glDrawArrays(GL_LINE_LOOP, 0, 392);
@@ -3325,17 +3354,17 @@ int main()
 
         glDrawArrays(GL_TRIANGLE_FAN, 0, 272);
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 3, 138);
         glDrawArrays(GL_TRIANGLE_FAN, 145, 28);
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         /*glDrawArrays(GL_TRIANGLE_FAN, 304, 86);
         glDrawArrays(GL_TRIANGLE_FAN, 355, 35);
         glDrawArrays(GL_TRIANGLE_FAN, 365, 25);
         glDrawArrays(GL_TRIANGLE_FAN, 304, 55);*/
         glDrawArrays(GL_TRIANGLE_FAN, 280, 111);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.38f, 0.186f, 0.176f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.38f, 0.186f, 0.176f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 90, 30);
         //glDrawArrays(GL_TRIANGLE_FAN, 50, 50);
 
@@ -3358,7 +3387,7 @@ int main()
 
 
         glDrawArrays(GL_LINE_STRIP, 608, 14);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 608, 14);
 
         /*glDrawArrays(GL_LINE_STRIP, 623, 17);
@@ -3370,11 +3399,11 @@ int main()
         glDrawArrays(GL_TRIANGLE_FAN, 641, 16);*/
 
         glDrawArrays(GL_LINE_STRIP, 658, 15);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 658, 15);
 
         glDrawArrays(GL_LINE_STRIP, 674, 16);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 674, 16);
 
         /*glDrawArrays(GL_LINE_STRIP, 691, 12);
@@ -3382,90 +3411,90 @@ int main()
         glDrawArrays(GL_TRIANGLE_FAN, 691, 12);*/
 
         glDrawArrays(GL_LINE_STRIP, 704, 15);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 704, 15);
 
         glDrawArrays(GL_LINE_STRIP, 720, 14);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 720, 14);
 
 
 
 
         glDrawArrays(GL_LINE_STRIP, 735, 7);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 735, 7);
 
         glDrawArrays(GL_LINE_STRIP, 741, 7);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 741, 7);
 
         glDrawArrays(GL_LINE_STRIP, 748, 7);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 748, 7);
 
         glDrawArrays(GL_LINE_STRIP, 755, 7);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 755, 7);
 
         glDrawArrays(GL_LINE_STRIP, 763, 8);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 763, 8);
 
         glDrawArrays(GL_LINE_STRIP, 770, 11);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 770, 11);
 
         glDrawArrays(GL_LINE_STRIP, 781, 6);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 781, 6);
 
         glDrawArrays(GL_LINE_STRIP, 787, 9);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 787, 9);
 
 
 
         glDrawArrays(GL_LINE_STRIP, 797, 194);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.4f, 0.7f, 0.9f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.4f, 0.7f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 797, 190);
 
 
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         //triangle fan
         glDrawArrays(GL_TRIANGLE_FAN, 991, 31);
         glDrawArrays(GL_TRIANGLE_FAN, 1022, 106);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1022, 46);
         //glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.38f, 0.186f, 0.176f, 1.0f)));
         //glDrawArrays(GL_TRIANGLE_FAN, 1080, 36);
         //top flag under bars
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         //glDrawArrays(GL_TRIANGLE_FAN, 1129, 55);
         glDrawArrays(GL_TRIANGLE_FAN, 1129, 20);
         glDrawArrays(GL_TRIANGLE_FAN, 1150, 14);
         glDrawArrays(GL_TRIANGLE_FAN, 1164, 20);
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1185, 30);
         glDrawArrays(GL_TRIANGLE_FAN, 1215, 22);
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1238, 50);
         glDrawArrays(GL_TRIANGLE_FAN, 1289, 37);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1285, 10);
         glDrawArrays(GL_TRIANGLE_FAN, 1316, 9);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1238, 50);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1327, 65);
         glDrawArrays(GL_TRIANGLE_FAN, 1395, 78);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1396, 10);
         glDrawArrays(GL_TRIANGLE_FAN, 1452, 12);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.118f, 0.118f, 0.118f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.118f, 0.118f, 0.118f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1470, 32);
         glDrawArrays(GL_TRIANGLE_FAN, 1502, 86);
         glDrawArrays(GL_TRIANGLE_FAN, 1590, 31);
@@ -3489,11 +3518,11 @@ int main()
         /*glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.322f, 0.169f, 0.176f, 1.0f)));
         glDrawArrays(GL_TRIANGLE_FAN, 1655, 4);*/
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.918f, 0.208f, 0.235f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.918f, 0.208f, 0.235f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1665, 37);
         /*glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f)));
         glDrawArrays(GL_TRIANGLE_FAN, 1661, 11);*/
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.996f, 0.569f, 0.122f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.996f, 0.569f, 0.122f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1704, 51);
         glDrawArrays(GL_TRIANGLE_FAN, 1756, 91);
         glDrawArrays(GL_TRIANGLE_FAN, 1847, 102);
@@ -3511,7 +3540,7 @@ int main()
         glDrawArrays(GL_LINE_STRIP, 1949, 66);
         glDrawArrays(GL_LINE_STRIP, 2015, 24);*/
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.4f, 0.129f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.4f, 0.129f, 1.0f));
 
         //glDrawArrays(GL_TRIANGLE_FAN, 2039, 73);
         glDrawArrays(GL_TRIANGLE_FAN, 2112, 111);
@@ -3519,10 +3548,10 @@ int main()
         /*glDrawArrays(GL_LINE_STRIP, 2039, 73);
         glDrawArrays(GL_LINE_STRIP, 2112, 111);*/
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.996f, 0.569f, 0.122f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.996f, 0.569f, 0.122f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 2223, 131);
         //glDrawArrays(GL_TRIANGLE_FAN, 2354, 62);
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.4f, 0.129f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.4f, 0.129f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 2416, 72);
         glDrawArrays(GL_TRIANGLE_FAN, 2490, 81);
         glDrawArrays(GL_TRIANGLE_FAN, 2572, 72);
@@ -3537,7 +3566,7 @@ int main()
         glDrawArrays(GL_LINE_STRIP, 2644, 36);
         glDrawArrays(GL_LINE_STRIP, 2680, 40);*/
 
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.325f, 0.671f, 0.749f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.325f, 0.671f, 0.749f, 1.0f));
         glDrawArrays(GL_LINE_STRIP, 2720, 95);
         glDrawArrays(GL_LINE_STRIP, 2815, 30);
         glDrawArrays(GL_LINE_STRIP, 2846, 58);
@@ -3552,31 +3581,31 @@ int main()
         //extra..
         //extra for translation,scaling,rotation etc..
         //for top right flag
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix2));
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.322f, 0.169f, 0.176f, 1.0f)));
+        glState.uniformMatrix4fv(transformLoc, modelMatrix2);
+        glState.uniform4fv(colorLocation, glm::vec4(0.322f, 0.169f, 0.176f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 1665, 37);
 
         //for ship boat window2
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelWindow));
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniformMatrix4fv(transformLoc, modelWindow);
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 608, 14);
 
         //for ship boat window3
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelWindow3));
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniformMatrix4fv(transformLoc, modelWindow3);
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 608, 14);
 
         //for ship boat window6/5
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelWindow5));
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.94f, 0.9f, 1.0f)));
+        glState.uniformMatrix4fv(transformLoc, modelWindow5);
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.94f, 0.9f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 674, 16);
 
         //for ship flag
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(modelFlag));
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(1.0f, 0.4f, 0.129f, 1.0f)));//1.0f, 0.4f, 0.129f, 1.0f
+        glState.uniformMatrix4fv(transformLoc, modelFlag);
+        glState.uniform4fv(colorLocation, glm::vec4(1.0f, 0.4f, 0.129f, 1.0f));//1.0f, 0.4f, 0.129f, 1.0f
         glDrawArrays(GL_TRIANGLE_FAN, 2112, 111);
         
-        glUniform4fv(colorLocation, 1, glm::value_ptr(glm::vec4(0.996f, 0.569f, 0.122f, 1.0f)));
+        glState.uniform4fv(colorLocation, glm::vec4(0.996f, 0.569f, 0.122f, 1.0f));
         glDrawArrays(GL_TRIANGLE_FAN, 2223, 131);
         //glDrawArrays(GL_TRIANGLE_FAN, 2354, 62);
 
@@ -3591,7 +3620,7 @@ int main()
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        framePacer.waitEvents(changed);
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
@@ -3608,50 +3637,63 @@ int main()
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+// returns true when the ship moved
+bool processInput(GLFWwindow* window)
 {
+    bool changed = false;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
     {
         rotateAngle += 1;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
     {
         rotateAngle -= 1;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
     {
         translate_Y += 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
     {
         translate_Y -= 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
     {
         translate_X += 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
     {
         translate_X -= 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
     {
         scale_X += 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
     {
         scale_X -= 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS)
     {
         scale_Y += 0.01;
+        changed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS)
     {
         scale_Y -= 0.01;
+        changed = true;
     }
+    return changed;
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -3660,5 +3702,13 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    glState.viewport(0, 0, width, height);
+    framePacer.requestRedraw();
+}
+
+// glfw: the window contents were damaged (uncovered, restored ...) and have to be drawn again
+// -------------------------------------------------------------------------------------------
+void window_refresh_callback(GLFWwindow* /*window*/)
+{
+    framePacer.requestRedraw();
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+//
+//  alloc_counter.h
+//  3D Object Drawing
+//
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// Heap allocation counter for the allocation-check build of the room.
+// Define ROOM_COUNT_ALLOCATIONS (project settings or top of main.cpp) to replace the global
+// operator new/delete with counting versions. Without the define this header only provides
+// the (always zero) counters, so it is free to include everywhere.
+// The replacement operators must be defined once per program: only main.cpp includes this.
+// Every thread counts its own allocations and a snapshot reads those of the calling thread,
+// so the shader file watcher and reload worker, which allocate on their own threads while
+// the room renders, are never charged to the render thread's frames.
+
+struct AllocationStats
+{
+    unsigned long long allocations;
+    unsigned long long frees;
+    unsigned long long bytes;
+};
+
+// the calling thread's counters (constant-initialized, so operator new can use them at any time)
+inline unsigned long long& allocCounterAllocations()
+{
+    static thread_local unsigned long long count = 0;
+    return count;
+}
+
+inline unsigned long long& allocCounterFrees()
+{
+    static thread_local unsigned long long count = 0;
+    return count;
+}
+
+inline unsigned long long& allocCounterBytes()
+{
+    static thread_local unsigned long long count = 0;
+    return count;
+}
+
+// snapshot of the calling thread's counters; subtract two snapshots to get the allocations of a frame
+inline AllocationStats allocCounterSnapshot()
+{
+    AllocationStats s;
+    s.allocations = allocCounterAllocations();
+    s.frees = allocCounterFrees();
+    s.bytes = allocCounterBytes();
+    return s;
+}
+
+inline bool allocCounterEnabled()
+{
+#ifdef ROOM_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Per-frame bookkeeping for the allocation-check build, on the render thread: skips a few warm-up frames (first
+// use of driver paths, iostream buffers...), then requires every measured frame to perform
+// zero allocations and collects allocations/frame and frame time for the report.
+class AllocationFrameCheck
+{
+public:
+    int WarmupFrames;
+    int MeasureFrames;
+
+    AllocationFrameCheck(int warmupFrames = 60, int measureFrames = 600) : WarmupFrames(warmupFrames), MeasureFrames(measureFrames),
+        frame(0), measured(0), failed(false), totalAllocations(0), maxAllocations(0), totalTime(0.0), frameStartTime(0.0)
+    {
+        frameStart = allocCounterSnapshot();
+    }
+
+    void beginFrame(double time)
+    {
+        frameStart = allocCounterSnapshot();
+        frameStartTime = time;
+    }
+
+    // returns false as soon as a measured frame allocated
+    bool endFrame(double time)
+    {
+        AllocationStats now = allocCounterSnapshot();
+        unsigned long long count = now.allocations - frameStart.allocations;
+        if (frame++ < WarmupFrames)
+            return true;
+
+        measured++;
+        totalAllocations += count;
+        if (count > maxAllocations)
+            maxAllocations = count;
+        totalTime += time - frameStartTime;
+        if (count != 0 && !failed)
+        {
+            failed = true;
+            std::cout << "ERROR::ALLOCATION_CHECK::FRAME_ALLOCATED frame " << frame - 1 << ": " << count
+                << " allocations, " << (now.bytes - frameStart.bytes) << " bytes" << std::endl;
+        }
+        return !failed;
+    }
+
+    bool finished() const
+    {
+        return failed || measured >= MeasureFrames;
+    }
+
+    bool passed() const
+    {
+        return !failed;
+    }
+
+    void report() const
+    {
+        if (measured == 0)
+            return;
+        std::cout << "allocation check: " << measured << " frames, "
+            << (double)totalAllocations / measured << " allocations/frame (max " << maxAllocations << "), "
+            << 1000.0 * totalTime / measured << " ms/frame -> " << (failed ? "FAILED" : "passed") << std::endl;
+    }
+
+private:
+    int frame;
+    int measured;
+    bool failed;
+    unsigned long long totalAllocations;
+    unsigned long long maxAllocations;
+    double totalTime;
+    double frameStartTime;
+    AllocationStats frameStart;
+};
+
+#ifdef ROOM_COUNT_ALLOCATIONS
+
+inline void* allocCounterAllocate(std::size_t size)
+{
+    allocCounterAllocations()++;
+    allocCounterBytes() += size;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+inline void allocCounterFree(void* p)
+{
+    if (!p)
+        return;
+    allocCounterFrees()++;
+    std::free(p);
+}
+
+void* operator new(std::size_t size) { return allocCounterAllocate(size); }
+void* operator new[](std::size_t size) { return allocCounterAllocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocCounterAllocations()++;
+    allocCounterBytes() += size;
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { allocCounterFree(p); }
+void operator delete[](void* p) noexcept { allocCounterFree(p); }
+void operator delete(void* p, std::size_t) noexcept { allocCounterFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { allocCounterFree(p); }
+
+#endif
+
+#endif
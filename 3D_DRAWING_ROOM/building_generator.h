@@ -0,0 +1,582 @@
+#pragma once
+
+//
+//  building_generator.h
+//  3D Object Drawing
+//
+
+#ifndef BUILDING_GENERATOR_H
+#define BUILDING_GENERATOR_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.h"
+#include "camera_collision.h"
+#include "draw_queue.h"
+#include "mesh_library.h"
+#include "object_picker.h"
+#include "occlusion_culler.h"
+#include "scene.h"
+#include "shader_variants.h"
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// splitmix64: tiny, fast and the same sequence on every platform and standard library,
+// which std::uniform_*_distribution does not promise
+class BuildingRandom
+{
+public:
+    explicit BuildingRandom(uint64_t seed) : state(seed)
+    {
+    }
+
+    uint64_t next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, 1)
+    float uniform()
+    {
+        return (float)(next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+    float range(float low, float high)
+    {
+        return low + (high - low) * uniform();
+    }
+
+    // [0, n)
+    uint32_t below(uint32_t n)
+    {
+        return (uint32_t)(((next() >> 32) * n) >> 32);
+    }
+
+private:
+    uint64_t state;
+};
+
+struct BuildingConfig
+{
+    unsigned int Rooms;             // 1 .. 10000 or more
+    unsigned int Floors;            // rooms are spread evenly over the storeys
+    unsigned int ExtraFurniture;    // furniture groups added to every room on top of the template's
+    float KeepChance;               // chance each of the template's furniture groups stays in a room
+    float Jitter;                   // largest shift of a furniture group along x and z
+    uint64_t Seed;
+
+    BuildingConfig(unsigned int rooms = 1, unsigned int floors = 1, unsigned int extraFurniture = 0, uint64_t seed = 1) :
+        Rooms(rooms), Floors(floors), ExtraFurniture(extraFurniture), KeepChance(0.85f), Jitter(0.3f), Seed(seed)
+    {
+    }
+};
+
+// Procedural buildings for stress tests, built from a room scene used as a template
+// (room.scene: walls, floor and window plus the furniture prefabs).
+//
+// The rooms are laid out floor by floor on a square-ish grid, one room's bounding box apart.
+// Each direct child of the template's root, with everything below it, is a piece:
+//  - pieces drawn only with flat prototypes (walls, floor, window) are structure and repeat
+//    unchanged in every room
+//  - the rest is furniture; furniture pieces whose boxes touch form a group that moves as
+//    one, so cups stay on their table
+// Per room, each furniture group is kept with KeepChance and shifted by up to Jitter, then
+// ExtraFurniture groups picked at random are dropped anywhere on the furnished area. The
+// shifts never leave the area the template's furniture covers.
+//
+// Room i draws its numbers from its own generator seeded with (Seed, i), so the output is a
+// pure function of the config and a room looks the same whatever the building's size.
+// Prototypes, parts and names are the template's; the copies keep their template names
+// and each room's root is called room_<i>. Animations (the fan) are copied with their nodes,
+// and the template root's cell with its portals becomes every room's cell, so the window of
+// one room leads into the next (PortalVisibility).
+class BuildingGenerator
+{
+public:
+    // statistics of the last generate()
+    unsigned int Rooms;
+    size_t Nodes;
+    size_t Cubes;
+    double Seconds;
+
+    BuildingGenerator() : Rooms(0), Nodes(0), Cubes(0), Seconds(0.0)
+    {
+    }
+
+    // false (and building left empty) when the template has no root or the config is empty
+    bool generate(const Scene& room, const BuildingConfig& config, Scene& building)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        building.clear();
+        Rooms = 0;
+        Nodes = 0;
+        Cubes = 0;
+        if (config.Rooms == 0 || config.Floors == 0)
+        {
+            std::cout << "ERROR::BUILDING::EMPTY_CONFIG" << std::endl;
+            return false;
+        }
+        if (!analyze(room))
+        {
+            std::cout << "ERROR::BUILDING::TEMPLATE_WITHOUT_ROOT" << std::endl;
+            return false;
+        }
+
+        building.Prototypes = room.Prototypes;
+        building.Parts = room.Parts;
+        building.Names = room.Names;
+
+        const unsigned int perFloor = (config.Rooms + config.Floors - 1) / config.Floors;
+        const unsigned int columns = (unsigned int)std::ceil(std::sqrt((double)perFloor));
+        const glm::vec3 pitch = roomMax - roomMin;
+        building.Nodes.reserve((size_t)config.Rooms * (room.Nodes.size() + config.ExtraFurniture * 2));
+
+        std::vector<glm::vec2> offsets(groups.size());
+        std::vector<bool> kept(groups.size());
+        for (unsigned int i = 0; i < config.Rooms; i++)
+        {
+            BuildingRandom random(config.Seed ^ ((uint64_t)(i + 1) * 0xD1B54A32D192ED03ull));
+            unsigned int floor = i / perFloor;
+            unsigned int cell = i % perFloor;
+            glm::vec3 origin((cell % columns) * pitch.x, floor * pitch.y, (cell / columns) * pitch.z);
+
+            SceneNode root = { addName(building, "room_" + std::to_string(i)), -1, Scene::NONE, 0,
+                glm::translate(glm::mat4(1.0f), origin) };
+            int32_t rootIndex = (int32_t)building.Nodes.size();
+            building.Nodes.push_back(root);
+            for (size_t c = 0; c < room.Cells.size(); c++)
+            {
+                if (room.Cells[c].node != rootNode)
+                    continue;
+                SceneCell cell = room.Cells[c];
+                cell.node = (uint32_t)rootIndex;
+                cell.firstPortal = (uint32_t)building.Portals.size();
+                building.Cells.push_back(cell);
+                building.Portals.insert(building.Portals.end(), room.Portals.begin() + room.Cells[c].firstPortal,
+                    room.Portals.begin() + room.Cells[c].firstPortal + cell.portalCount);
+            }
+
+            for (size_t g = 0; g < groups.size(); g++)
+            {
+                kept[g] = random.uniform() < config.KeepChance;
+                offsets[g] = glm::vec2(random.range(-config.Jitter, config.Jitter), random.range(-config.Jitter, config.Jitter));
+            }
+            for (size_t p = 0; p < pieces.size(); p++)
+            {
+                const Piece& piece = pieces[p];
+                if (piece.group < 0)
+                    copyPiece(room, piece, rootIndex, glm::vec2(0.0f), building);
+                else if (kept[piece.group])
+                    copyPiece(room, piece, rootIndex, clampShift(groups[piece.group], offsets[piece.group]), building);
+            }
+            for (unsigned int e = 0; e < config.ExtraFurniture && !groups.empty(); e++)
+            {
+                const Group& group = groups[random.below((uint32_t)groups.size())];
+                glm::vec2 anywhere(random.range(furnishedMin.x - group.min.x, furnishedMax.x - group.max.x),
+                    random.range(furnishedMin.y - group.min.y, furnishedMax.y - group.max.y));
+                glm::vec2 shift = clampShift(group, anywhere);
+                for (size_t k = 0; k < group.pieces.size(); k++)
+                    copyPiece(room, pieces[group.pieces[k]], rootIndex, shift, building);
+            }
+        }
+
+        Rooms = config.Rooms;
+        Nodes = building.Nodes.size();
+        Cubes = building.placedParts();
+        Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    void report() const
+    {
+        std::cout << "building: " << Rooms << " rooms, " << Nodes << " nodes, " << Cubes << " cubes, generated in "
+            << 1000.0 * Seconds << " ms" << std::endl;
+    }
+
+private:
+    // a direct child of the template root and its subtree: template nodes [first, last)
+    struct Piece
+    {
+        uint32_t first;
+        uint32_t last;
+        int group;              // index into groups, -1 for structure
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // furniture pieces that move together; min/max is their x/z footprint
+    struct Group
+    {
+        std::vector<uint32_t> pieces;
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    std::vector<Piece> pieces;
+    std::vector<Group> groups;
+    // per template node: its piece, its animation (or -1) and its index in the last copy
+    std::vector<int> pieceOf;
+    std::vector<int> animationOf;
+    std::vector<int32_t> copiedAs;
+    uint32_t rootNode;
+    glm::vec3 roomMin;
+    glm::vec3 roomMax;
+    glm::vec2 furnishedMin;
+    glm::vec2 furnishedMax;
+
+    // splits the template into pieces and groups and measures it at rest
+    bool analyze(const Scene& room)
+    {
+        pieces.clear();
+        groups.clear();
+        int root = -1;
+        for (size_t i = 0; i < room.Nodes.size() && root < 0; i++)
+            if (room.Nodes[i].parent < 0)
+                root = (int)i;
+        if (root < 0)
+            return false;
+        rootNode = (uint32_t)root;
+
+        // rest pose in the root's space; a piece spans the template nodes from its top node to
+        // its last descendant
+        std::vector<glm::mat4> world(room.Nodes.size(), glm::mat4(1.0f));
+        pieceOf.assign(room.Nodes.size(), -1);
+        copiedAs.assign(room.Nodes.size(), -1);
+        for (size_t i = 0; i < room.Nodes.size(); i++)
+        {
+            const SceneNode& node = room.Nodes[i];
+            if ((int)i == root || node.parent < 0)
+                continue;
+            world[i] = (node.parent == root ? glm::mat4(1.0f) : world[node.parent]) * node.local;
+            if (node.parent == root)
+            {
+                Piece piece = { (uint32_t)i, (uint32_t)i + 1, -1, glm::vec3(1e30f), glm::vec3(-1e30f) };
+                pieceOf[i] = (int)pieces.size();
+                pieces.push_back(piece);
+            }
+            else
+                pieceOf[i] = pieceOf[node.parent];
+            if (pieceOf[i] < 0)
+                continue;
+            Piece& piece = pieces[pieceOf[i]];
+            piece.last = (uint32_t)i + 1;
+            if (node.prototype == Scene::NONE)
+                continue;
+            const ScenePrototype& prototype = room.Prototypes[node.prototype];
+            if (prototype.features & SHADER_LIGHTING)
+                piece.group = 0;
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+                expandCube(world[i] * room.Parts[k].model, piece.min, piece.max);
+        }
+
+        animationOf.assign(room.Nodes.size(), -1);
+        for (size_t a = 0; a < room.Animations.size(); a++)
+            animationOf[room.Animations[a].node] = (int)a;
+
+        // group touching furniture; the template is small, so pairwise is fine
+        roomMin = glm::vec3(1e30f);
+        roomMax = glm::vec3(-1e30f);
+        furnishedMin = glm::vec2(1e30f);
+        furnishedMax = glm::vec2(-1e30f);
+        std::vector<int> label(pieces.size(), -1);
+        for (size_t p = 0; p < pieces.size(); p++)
+        {
+            Piece& piece = pieces[p];
+            if (piece.min.x > piece.max.x)
+            {
+                piece.group = -1;
+                continue;
+            }
+            roomMin = glm::min(roomMin, piece.min);
+            roomMax = glm::max(roomMax, piece.max);
+            if (piece.group < 0)
+                continue;
+            furnishedMin = glm::min(furnishedMin, glm::vec2(piece.min.x, piece.min.z));
+            furnishedMax = glm::max(furnishedMax, glm::vec2(piece.max.x, piece.max.z));
+            label[p] = (int)p;
+        }
+        if (roomMin.x > roomMax.x)
+            return false;
+        for (bool merged = true; merged; )
+        {
+            merged = false;
+            for (size_t a = 0; a < pieces.size(); a++)
+                for (size_t b = a + 1; b < pieces.size(); b++)
+                    if (label[a] >= 0 && label[b] >= 0 && label[a] != label[b] && piecesTouch(pieces[a], pieces[b]))
+                    {
+                        label[a] = label[b] = std::min(label[a], label[b]);
+                        merged = true;
+                    }
+        }
+        std::vector<int> groupOfLabel(pieces.size(), -1);
+        for (size_t p = 0; p < pieces.size(); p++)
+        {
+            pieces[p].group = -1;
+            if (label[p] < 0)
+                continue;
+            if (groupOfLabel[label[p]] < 0)
+            {
+                groupOfLabel[label[p]] = (int)groups.size();
+                Group group = { std::vector<uint32_t>(), glm::vec2(1e30f), glm::vec2(-1e30f) };
+                groups.push_back(group);
+            }
+            Group& group = groups[groupOfLabel[label[p]]];
+            pieces[p].group = groupOfLabel[label[p]];
+            group.pieces.push_back((uint32_t)p);
+            group.min = glm::min(group.min, glm::vec2(pieces[p].min.x, pieces[p].min.z));
+            group.max = glm::max(group.max, glm::vec2(pieces[p].max.x, pieces[p].max.z));
+        }
+        return true;
+    }
+
+    // shift limited so the group stays on the furnished area (or where it was, if it is wider)
+    glm::vec2 clampShift(const Group& group, glm::vec2 shift) const
+    {
+        glm::vec2 low = glm::min(furnishedMin - group.min, glm::vec2(0.0f));
+        glm::vec2 high = glm::max(furnishedMax - group.max, glm::vec2(0.0f));
+        return glm::clamp(shift, low, high);
+    }
+
+    // appends a piece under parent, moved by shift on the floor plane
+    void copyPiece(const Scene& room, const Piece& piece, int32_t parent, glm::vec2 shift, Scene& building)
+    {
+        int index = (int)(&piece - &pieces[0]);
+        for (uint32_t i = piece.first; i < piece.last; i++)
+        {
+            // the range can hold nodes of other pieces when the file interleaves them
+            if (pieceOf[i] != index)
+                continue;
+            SceneNode node = room.Nodes[i];
+            if (i == piece.first)
+            {
+                node.parent = parent;
+                node.local = glm::translate(glm::mat4(1.0f), glm::vec3(shift.x, 0.0f, shift.y)) * node.local;
+            }
+            else
+                node.parent = copiedAs[node.parent];
+            copiedAs[i] = (int32_t)building.Nodes.size();
+            if (animationOf[i] >= 0)
+            {
+                SceneAnimation animation = room.Animations[animationOf[i]];
+                animation.node = (uint32_t)building.Nodes.size();
+                building.Animations.push_back(animation);
+            }
+            building.Nodes.push_back(node);
+        }
+    }
+
+    static void expandCube(const glm::mat4& model, glm::vec3& min, glm::vec3& max)
+    {
+        for (int c = 0; c < 8; c++)
+        {
+            glm::vec3 corner((c & 1) ? 0.5f : 0.0f, (c & 2) ? 0.5f : 0.0f, (c & 4) ? 0.5f : 0.0f);
+            glm::vec3 p = glm::vec3(model * glm::vec4(corner, 1.0f));
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+    }
+
+    // boxes that intersect or touch: a cup standing on a table, not a fan above it
+    static bool piecesTouch(const Piece& a, const Piece& b)
+    {
+        const float touch = 0.01f;
+        for (int k = 0; k < 3; k++)
+            if (a.min[k] > b.max[k] + touch || b.min[k] > a.max[k] + touch)
+                return false;
+        return true;
+    }
+
+    static uint32_t addName(Scene& scene, const std::string& text)
+    {
+        uint32_t offset = (uint32_t)scene.Names.size();
+        scene.Names.insert(scene.Names.end(), text.begin(), text.end());
+        scene.Names.push_back('\0');
+        return offset;
+    }
+};
+
+// one frame's per-copy submission work as IndirectDrawer::flush() does it: sort, then write
+// every copy's matrix and color; returns the copies written
+inline size_t benchmarkSubmit(DrawQueue& queue, std::vector<glm::vec4>& texels)
+{
+    queue.sort();
+    texels.clear();
+    for (size_t i = 0; i < queue.size(); i++)
+    {
+        const DrawPacket& packet = queue.sorted(i);
+        for (uint32_t copy = 0; copy < packet.instanceCount; copy++)
+        {
+            const glm::mat4& model = queue.instanceModel(packet, copy);
+            texels.push_back(model[0]);
+            texels.push_back(model[1]);
+            texels.push_back(model[2]);
+            texels.push_back(model[3]);
+            texels.push_back(packet.color);
+        }
+    }
+    return texels.size() / 5;
+}
+
+// Generates buildings of 1 to 10,000 rooms from room.scene and times the per-frame CPU work
+// on them: animating and updating the hierarchy, then recording and submitting the view from
+// a corner of a room in the middle of the ground floor with frustum culling alone, with occlusion
+// culling added (rasterizing occluders included) and with portal visibility in front of both
+// (walking the portals included), then times camera collision for a walk around that room and
+// picking through random pixels of the view, one ray at a time and batched.
+// The meshes are the library the scene draws with: the cube, then room.scene's meshes
+// (Scene::buildMeshes()).
+// Build with ROOM_BENCH_BUILDING defined to run it from main() instead of opening the room.
+inline void benchmarkBuilding(const MeshLibrary& meshes)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    // recording only keeps a pointer to the variants, nothing is compiled
+    ShaderVariants variants("vertexShader.vs", "fragmentShader.fs");
+    Scene room;
+    if (!room.load("room.scene") || !room.useMeshes(meshes))
+        return;
+    const float* vertices = meshes.vertexData();
+    const unsigned int* indices = meshes.indexData();
+    const size_t vertexCount = meshes.vertexCount(), stride = MeshLibrary::STRIDE, indexCount = meshes.indexCount();
+    const size_t boxIndexCount = meshes.mesh(0).indexCount;
+    OcclusionCuller culler;
+    culler.setMesh(vertices, vertexCount, stride, indices, indexCount);
+
+    const unsigned int counts[] = { 1, 100, 1000, 10000 };
+    std::cout << "building benchmark (per-frame CPU times, occlusion culling " << BatchLane::name() << ")" << std::endl;
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        const unsigned int rooms = counts[c];
+        const unsigned int floors = rooms >= 100 ? 10 : 1;
+        BuildingConfig config(rooms, floors, 4, 2024);
+        BuildingGenerator generator;
+        Scene building;
+        if (!generator.generate(room, config, building))
+            return;
+        generator.report();
+
+        TransformHierarchy hierarchy;
+        SceneInstance instance = building.instantiate(hierarchy);
+        DrawQueue queue;
+        queue.LocalMin = glm::vec3(0.0f);
+        queue.LocalMax = glm::vec3(0.5f);
+        std::vector<glm::vec4> texels;
+        building.animate(instance, 0.0, hierarchy);
+        hierarchy.update();
+        PortalVisibility visibility;
+        building.buildVisibility(instance, hierarchy, visibility);
+
+        const int repeats = rooms >= 1000 ? 3 : 20;
+        Clock::time_point start = Clock::now();
+        for (int k = 0; k < repeats; k++)
+        {
+            building.animate(instance, 0.25 * (k + 1), hierarchy);
+            hierarchy.update();
+        }
+        double updateTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+        // standing in a corner of the middle room of the ground floor, looking across it
+        std::string middle = "room_" + std::to_string((rooms / floors) / 2);
+        glm::vec3 origin(building.Nodes[building.findNode(middle.c_str())].local[3]);
+        Camera camera(origin + glm::vec3(-0.8f, 1.6f, -0.3f), glm::vec3(0.0f, 1.0f, 0.0f), 40.0f, -15.0f);
+
+        // frustum only, with occlusion, with portals and occlusion
+        double times[3] = { 0.0, 0.0, 0.0 };
+        size_t copies[3] = { 0, 0, 0 };
+        unsigned int rejected[3] = { 0, 0, 0 }, occluders[3] = { 0, 0, 0 };
+        for (int mode = 0; mode < 3; mode++)
+        {
+            const PortalVisibility* cells = mode == 2 ? &visibility : nullptr;
+            // the first pass is untimed and sizes every buffer
+            for (int k = 0; k <= repeats; k++)
+            {
+                start = Clock::now();
+                if (cells)
+                    visibility.update(camera.Position, camera.GetFrustumPlanes());
+                queue.begin(camera.GetViewMatrix(), camera.NearPlane, camera.FarPlane);
+                queue.setFrustum(camera.GetFrustumPlanes());
+                if (mode > 0)
+                {
+                    culler.begin(camera.GetViewProjectionMatrix(), camera.GetFrustumPlanes());
+                    building.recordOccluders(instance, hierarchy, culler, cells);
+                    culler.rasterize();
+                    queue.setOcclusion(&culler);
+                }
+                building.record(instance, hierarchy, queue, variants, 0, cells);
+                copies[mode] = benchmarkSubmit(queue, texels);
+                if (k > 0)
+                    times[mode] += std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+            }
+            rejected[mode] = culler.Rejected;
+            occluders[mode] = culler.Occluders;
+        }
+
+        std::cout << "  " << rooms << " rooms: animate + update " << updateTime << " ms; frustum only " << copies[0] << " copies in "
+            << times[0] << " ms; with occlusion " << copies[1] << " copies in " << times[1] << " ms ("
+            << rejected[1] << " boxes rejected, " << occluders[1] << " occluders); with portals " << copies[2] << " copies in "
+            << times[2] << " ms (" << visibility.VisibleCells << " of " << visibility.cellCount() << " cells visible, "
+            << rejected[2] << " boxes rejected, " << occluders[2] << " occluders)" << std::endl;
+
+        // wandering about the middle room at walking speed, bumping into walls and furniture
+        CameraCollider collider;
+        collider.setMesh(vertices, vertexCount, stride, indices, indexCount, boxIndexCount);
+        start = Clock::now();
+        building.addColliders(instance, hierarchy, collider);
+        collider.build();
+        double buildTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        BuildingRandom random(7);
+        glm::vec3 eye = origin + glm::vec3(1.2f, 1.6f, 1.2f), direction(1.0f, 0.0f, 0.0f);
+        unsigned int slides = 0;
+        for (int k = 0; k < 10000; k++)
+        {
+            if (k % 100 == 0)
+                direction = glm::normalize(glm::vec3(random.range(-1.0f, 1.0f), random.range(-0.3f, 0.3f), random.range(-1.0f, 1.0f)));
+            eye = collider.move(eye, eye + direction * (camera.MovementSpeed / 60.0f));
+            slides += collider.Slides;
+        }
+        std::cout << "    camera collision: " << collider.Boxes << " boxes gridded in " << buildTime << " ms; " << collider.Moves
+            << " moves (" << slides << " slides) " << 1000.0 * collider.TotalSeconds / collider.Moves << " ms on average, "
+            << 1000.0 * collider.MaxSeconds << " ms at most" << std::endl;
+
+        ObjectPicker picker;
+        picker.setMesh(vertices, vertexCount, stride, indices, indexCount, boxIndexCount);
+        start = Clock::now();
+        picker.build(building, instance, hierarchy);
+        buildTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        const size_t rays = 100000;
+        std::vector<glm::vec2> pixels(rays);
+        for (size_t k = 0; k < rays; k++)
+            pixels[k] = glm::vec2(random.range(0.0f, 800.0f), random.range(0.0f, 600.0f));
+        std::vector<PickHit> hits(rays);
+        const glm::mat4& inverseViewProjection = camera.GetInverseViewProjectionMatrix();
+        size_t picked = 0;
+        start = Clock::now();
+        for (size_t k = 0; k < rays; k++)
+            picked += picker.pick(ObjectPicker::rayThroughPixel(inverseViewProjection, pixels[k], glm::vec2(800.0f, 600.0f))).node != Scene::NONE ? 1 : 0;
+        double pickTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rays;
+        start = Clock::now();
+        picker.pickPixels(inverseViewProjection, glm::vec2(800.0f, 600.0f), pixels.data(), rays, hits.data());
+        double batchTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / rays;
+        std::cout << "    picking: " << picker.Objects << " objects (" << picker.MovingObjects << " moving), " << picker.TreeNodes
+            << " tree nodes built in " << buildTime << " ms; " << rays << " rays, " << picked << " hits, " << pickTime
+            << " us a ray, " << batchTime << " us a ray batched" << std::endl;
+    }
+
+    // tens of millions of cubes: generation only, recording them would need gigabytes
+    BuildingGenerator generator;
+    Scene building;
+    if (generator.generate(room, BuildingConfig(10000, 10, 150, 2024), building))
+        generator.report();
+}
+
+#endif
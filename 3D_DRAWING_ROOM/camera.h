@@ -11,6 +11,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 
@@ -31,6 +32,13 @@ enum Camera_Movement {
     WORLD_UP
 };
 
+// How orientation is stored. EULER_CAMERA is the classic yaw/pitch fly camera (roll is ignored);
+// QUATERNION_CAMERA keeps a quaternion, applies roll and has no pitch limit or gimbal lock
+enum Camera_Mode {
+    EULER_CAMERA,
+    QUATERNION_CAMERA
+};
+
 // Default camera values
 const float YAW = 0.0f;
 const float PITCH = 0.0f;
@@ -38,7 +46,47 @@ const float ROLL = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ASPECT = 4.0f / 3.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+// frustum plane order in Camera::GetFrustumPlanes(); planes are (normal, d) with normals pointing inside
+enum Frustum_Plane {
+    FRUSTUM_LEFT,
+    FRUSTUM_RIGHT,
+    FRUSTUM_BOTTOM,
+    FRUSTUM_TOP,
+    FRUSTUM_NEAR,
+    FRUSTUM_FAR
+};
+
+// where a camera is and which way it looks, for blending between two simulation steps
+struct CameraPose
+{
+    glm::vec3 Position;
+    glm::quat Orientation;  // camera local space: x right, y up, -z front
 
+    bool operator==(const CameraPose& other) const
+    {
+        return Position == other.Position && Orientation == other.Orientation;
+    }
+    bool operator!=(const CameraPose& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// a pose t (0..1) of the way from a to b; exactly a when nothing moved, so a camera at rest
+// keeps its matrices (and version)
+inline CameraPose MixPoses(const CameraPose& a, const CameraPose& b, float t)
+{
+    if (a == b)
+        return b;
+    CameraPose pose;
+    pose.Position = a.Position + (b.Position - a.Position) * t;
+    pose.Orientation = a.Orientation == b.Orientation ? b.Orientation : glm::slerp(a.Orientation, b.Orientation, t);
+    return pose;
+}
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera
@@ -54,13 +102,21 @@ public:
     float Yaw;
     float Pitch;
     float Roll;
+    // orientation used in QUATERNION_CAMERA mode (camera local space: x right, y up, -z front)
+    Camera_Mode Mode;
+    glm::quat Orientation;
     // camera options
     float MovementSpeed;
     float MouseSensitivity;
     float Zoom;
+    // projection options, Zoom is the vertical field of view in degrees
+    float Aspect;
+    float NearPlane;
+    float FarPlane;
 
     // constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH, float roll = ROLL) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH, float roll = ROLL) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), Mode(EULER_CAMERA), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+        Aspect(ASPECT), NearPlane(NEAR_PLANE), FarPlane(FAR_PLANE), pendingRotation(0.0f), version(0), viewValid(false), projectionValid(false), vectorsValid(false)
     {
         Position = position;
         WorldUp = up;
@@ -70,7 +126,8 @@ public:
         updateCameraVectors();
     }
     // constructor with scalar values
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch, float roll) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch, float roll) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), Mode(EULER_CAMERA), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+        Aspect(ASPECT), NearPlane(NEAR_PLANE), FarPlane(FAR_PLANE), pendingRotation(0.0f), version(0), viewValid(false), projectionValid(false), vectorsValid(false)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -81,15 +138,144 @@ public:
     }
 
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-    glm::mat4 GetViewMatrix()
+    const glm::mat4& GetViewMatrix()
+    {
+        refresh();
+        return view;
+    }
+
+    const glm::mat4& GetProjectionMatrix()
+    {
+        refresh();
+        return projection;
+    }
+
+    const glm::mat4& GetViewProjectionMatrix()
+    {
+        refresh();
+        return viewProjection;
+    }
+
+    const glm::mat4& GetInverseViewMatrix()
     {
-        return glm::lookAt(Position, Position + Front, Up);
+        refresh();
+        return inverseView;
+    }
+
+    const glm::mat4& GetInverseProjectionMatrix()
+    {
+        refresh();
+        return inverseProjection;
+    }
+
+    const glm::mat4& GetInverseViewProjectionMatrix()
+    {
+        refresh();
+        return inverseViewProjection;
+    }
+
+    // six world space planes indexed by Frustum_Plane, normalized so dot(plane.xyz, p) + plane.w is a distance
+    const glm::vec4* GetFrustumPlanes()
+    {
+        refresh();
+        return frustum;
+    }
+
+    // conservative test of a world space axis aligned box against the frustum
+    bool IsBoxInFrustum(const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        refresh();
+        for (int i = 0; i < 6; i++)
+        {
+            // the box corner furthest along the plane normal
+            glm::vec3 p(frustum[i].x >= 0.0f ? boxMax.x : boxMin.x,
+                        frustum[i].y >= 0.0f ? boxMax.y : boxMin.y,
+                        frustum[i].z >= 0.0f ? boxMax.z : boxMin.z);
+            if (glm::dot(glm::vec3(frustum[i]), p) + frustum[i].w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // bumped whenever any of the matrices above change; compare against a stored value to skip
+    // work (culling, uploads ...) on frames where the camera did not move
+    unsigned int GetVersion()
+    {
+        refresh();
+        return version;
+    }
+
+    // the current position and view direction
+    CameraPose GetPose()
+    {
+        if (Mode == QUATERNION_CAMERA)
+            applyPendingRotation();
+        CameraPose pose;
+        pose.Position = Position;
+        pose.Orientation = glm::normalize(glm::quat_cast(glm::mat3(Right, Up, -Front)));
+        return pose;
+    }
+
+    // place the camera at pose; a yaw/pitch camera takes the direction vectors as they are
+    // (including any roll) until the next input moves it
+    void SetPose(const CameraPose& pose)
+    {
+        Position = pose.Position;
+        glm::mat3 basis = glm::mat3_cast(pose.Orientation);
+        Right = basis[0];
+        Up = basis[1];
+        Front = -basis[2];
+        if (Mode == QUATERNION_CAMERA)
+        {
+            Orientation = pose.Orientation;
+            pendingRotation = glm::vec3(0.0f);
+        }
+    }
+
+    // switching keeps the current view direction
+    void SetMode(Camera_Mode mode)
+    {
+        if (mode == Mode)
+            return;
+        if (mode == QUATERNION_CAMERA)
+        {
+            Orientation = glm::normalize(glm::quat_cast(glm::mat3(Right, Up, -Front)));
+            pendingRotation = glm::vec3(0.0f);
+        }
+        else
+        {
+            applyPendingRotation();
+            Yaw = glm::degrees(atan2(Front.z, Front.x));
+            Pitch = glm::degrees(asin(glm::clamp(Front.y, -1.0f, 1.0f)));
+            vectorsValid = false;
+        }
+        Mode = mode;
+        updateCameraVectors();
+    }
+
+    void SetAspect(float aspect)
+    {
+        Aspect = aspect;
+    }
+
+    void SetPerspective(float aspect, float nearPlane, float farPlane)
+    {
+        Aspect = aspect;
+        NearPlane = nearPlane;
+        FarPlane = farPlane;
     }
 
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
         float velocity = MovementSpeed * deltaTime;
+        if (Mode == QUATERNION_CAMERA)
+        {
+            // rotations are only queued; they are applied together once per frame
+            if (queueRotation(direction, 15 * velocity))
+                return;
+            applyPendingRotation();
+        }
         if (direction == FORWARD)
             Position += Front * velocity;
         if (direction == BACKWARD)
@@ -132,6 +318,13 @@ public:
         xoffset *= MouseSensitivity;
         yoffset *= MouseSensitivity;
 
+        if (Mode == QUATERNION_CAMERA)
+        {
+            pendingRotation.x += yoffset;
+            pendingRotation.y += xoffset;
+            return;
+        }
+
         Yaw += xoffset;
         Pitch += yoffset;
         /*Roll += zoffset;*/
@@ -160,9 +353,134 @@ public:
     }
 
 private:
+    // cached matrices and the inputs they were built from. The attributes above are public and
+    // may be written directly, so staleness is detected by comparing against these inputs
+    // degrees of pitch (x), yaw (y) and roll (z) queued since the last applyPendingRotation()
+    glm::vec3 pendingRotation;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 frustum[6];
+    unsigned int version;
+    bool viewValid;
+    bool projectionValid;
+    glm::vec3 viewPosition;
+    glm::vec3 viewFront;
+    glm::vec3 viewUp;
+    float projectionZoom;
+    float projectionAspect;
+    float projectionNear;
+    float projectionFar;
+    // angles the direction vectors were last computed from
+    bool vectorsValid;
+    float vectorsYaw;
+    float vectorsPitch;
+    glm::vec3 vectorsWorldUp;
+
+    // rebuild whatever went stale since the last query
+    void refresh()
+    {
+        if (Mode == QUATERNION_CAMERA)
+            applyPendingRotation();
+        bool viewChanged = !viewValid || Position != viewPosition || Front != viewFront || Up != viewUp;
+        bool projectionChanged = !projectionValid || Zoom != projectionZoom || Aspect != projectionAspect ||
+            NearPlane != projectionNear || FarPlane != projectionFar;
+        if (!viewChanged && !projectionChanged)
+            return;
+
+        if (viewChanged)
+        {
+            view = glm::lookAt(Position, Position + Front, Up);
+            inverseView = glm::inverse(view);
+            viewPosition = Position;
+            viewFront = Front;
+            viewUp = Up;
+            viewValid = true;
+        }
+        if (projectionChanged)
+        {
+            projection = glm::perspective(glm::radians(Zoom), Aspect, NearPlane, FarPlane);
+            inverseProjection = glm::inverse(projection);
+            projectionZoom = Zoom;
+            projectionAspect = Aspect;
+            projectionNear = NearPlane;
+            projectionFar = FarPlane;
+            projectionValid = true;
+        }
+        viewProjection = projection * view;
+        inverseViewProjection = inverseView * inverseProjection;
+        updateFrustumPlanes();
+        version++;
+    }
+
+    // Gribb/Hartmann: each plane is the last row of the view-projection matrix plus/minus another row
+    void updateFrustumPlanes()
+    {
+        const glm::mat4& m = viewProjection;
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+        frustum[FRUSTUM_LEFT] = row3 + row0;
+        frustum[FRUSTUM_RIGHT] = row3 - row0;
+        frustum[FRUSTUM_BOTTOM] = row3 + row1;
+        frustum[FRUSTUM_TOP] = row3 - row1;
+        frustum[FRUSTUM_NEAR] = row3 + row2;
+        frustum[FRUSTUM_FAR] = row3 - row2;
+        for (int i = 0; i < 6; i++)
+            frustum[i] /= glm::length(glm::vec3(frustum[i]));
+    }
+
+    // adds a rotation key to the frame's pending rotation; false for movement keys
+    bool queueRotation(Camera_Movement direction, float degrees)
+    {
+        switch (direction)
+        {
+        case YAW_L:   pendingRotation.y -= degrees; return true;
+        case YAW_R:   pendingRotation.y += degrees; return true;
+        case PITCH_C: pendingRotation.x -= degrees; return true;
+        case PITCH_A: pendingRotation.x += degrees; return true;
+        case ROLL_L:  pendingRotation.z -= degrees; return true;
+        case ROLL_R:  pendingRotation.z += degrees; return true;
+        default:      return false;
+        }
+    }
+
+    // integrates all queued rotations as one turn about their combined local axis, then reads
+    // the basis vectors straight out of the rotation matrix (no per-axis trig)
+    void applyPendingRotation()
+    {
+        if (pendingRotation == glm::vec3(0.0f))
+            return;
+        // yaw right and roll right are negative turns about local +y and +z
+        glm::vec3 axis(glm::radians(pendingRotation.x), -glm::radians(pendingRotation.y), -glm::radians(pendingRotation.z));
+        float angle = glm::length(axis);
+        Orientation = glm::normalize(Orientation * glm::angleAxis(angle, axis / angle));
+        pendingRotation = glm::vec3(0.0f);
+
+        glm::mat3 basis = glm::mat3_cast(Orientation);
+        Right = basis[0];
+        Up = basis[1];
+        Front = -basis[2];
+    }
+
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
     {
+        // the quaternion mode derives its vectors in applyPendingRotation()
+        if (Mode == QUATERNION_CAMERA)
+            return;
+        // translation and roll keys land here too; the trig is only needed when the angles moved
+        if (vectorsValid && Yaw == vectorsYaw && Pitch == vectorsPitch && WorldUp == vectorsWorldUp)
+            return;
+        vectorsValid = true;
+        vectorsYaw = Yaw;
+        vectorsPitch = Pitch;
+        vectorsWorldUp = WorldUp;
+
         // calculate the new Front vector
         glm::vec3 front;
         front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
@@ -0,0 +1,190 @@
+#pragma once
+
+//
+//  camera_collision.h
+//  3D Object Drawing
+//
+
+#ifndef CAMERA_COLLISION_H
+#define CAMERA_COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include "spatial_hash_grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Keeps the camera out of the scene's static geometry. The eye is a sphere of Radius swept
+// from where it was to where input moved it; on contact it stops just short of the surface
+// and the rest of the move slides along it, up to MAX_SLIDES times, so walking into a wall at
+// an angle runs along the wall instead of sticking to it.
+//
+// The geometry is world boxes: a part drawn with a whole mesh is one box, a part drawn with
+// some of the cube's faces (the walls) is one box per face. The sweep is a ray against each
+// box grown by Radius, which rounds nothing off at edges and corners and so keeps the eye a
+// little further away there. A SpatialHashGrid over the boxes, built once, limits the sweep
+// to the boxes near the move. A box the eye already starts in is ignored so it can always
+// walk out.
+class CameraCollider
+{
+public:
+    float Radius;
+    // statistics: since build(), and of the last move()
+    size_t Boxes;
+    unsigned int Moves;
+    unsigned int Candidates;
+    unsigned int Slides;
+    double Seconds;
+    double TotalSeconds;
+    double MaxSeconds;
+
+    CameraCollider() : Radius(0.2f), Boxes(0), Moves(0), Candidates(0), Slides(0), Seconds(0.0), TotalSeconds(0.0), MaxSeconds(0.0), boxIndices(0), grid(2.0f)
+    {
+    }
+
+    // vertex positions are the first three floats of every stride floats; the first
+    // boxIndexCount indices (all when 0) are the box mesh (the cube) whose faces addPart() splits
+    void setMesh(const float* vertices, size_t vertexCount, size_t stride, const unsigned int* meshIndices, size_t indexCount, size_t boxIndexCount = 0)
+    {
+        boxIndices = boxIndexCount ? boxIndexCount : indexCount;
+        positions.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++)
+            positions[i] = glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+        indices.assign(meshIndices, meshIndices + indexCount);
+    }
+
+    void clear()
+    {
+        boxMin.clear();
+        boxMax.clear();
+    }
+
+    void addBox(const glm::vec3& min, const glm::vec3& max)
+    {
+        boxMin.push_back(min);
+        boxMax.push_back(max);
+    }
+
+    // a part drawn with model and indices [firstIndex, firstIndex + indexCount) of the mesh
+    void addPart(const glm::mat4& model, uint32_t firstIndex, uint32_t indexCount)
+    {
+        // a whole mesh is one box, some of the box mesh's faces a box per face (two triangles)
+        uint32_t faceIndices = firstIndex < boxIndices && indexCount < boxIndices ? 6 : indexCount;
+        for (uint32_t first = firstIndex; first + faceIndices <= firstIndex + indexCount && first + faceIndices <= indices.size(); first += faceIndices)
+        {
+            glm::vec3 min(1e30f), max(-1e30f);
+            for (uint32_t i = first; i < first + faceIndices; i++)
+            {
+                glm::vec3 p = glm::vec3(model * glm::vec4(positions[indices[i]], 1.0f));
+                min = glm::min(min, p);
+                max = glm::max(max, p);
+            }
+            addBox(min, max);
+        }
+    }
+
+    // call once after adding the boxes
+    void build()
+    {
+        grid.reset(boxMin.size());
+        grid.insertAll(boxMin.data(), boxMax.data(), boxMin.size());
+        Boxes = boxMin.size();
+        Moves = 0;
+        TotalSeconds = 0.0;
+        MaxSeconds = 0.0;
+    }
+
+    // where the eye ends up moving from from towards to
+    glm::vec3 move(const glm::vec3& from, const glm::vec3& to)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Candidates = 0;
+        Slides = 0;
+        glm::vec3 position = from;
+        glm::vec3 remaining = to - from;
+        for (int slide = 0; slide <= MAX_SLIDES && glm::dot(remaining, remaining) > 1e-12f; slide++)
+        {
+            glm::vec3 end = position + remaining;
+            nearby.clear();
+            grid.queryBox(glm::min(position, end) - Radius, glm::max(position, end) + Radius, [&](uint32_t id) { nearby.push_back(id); });
+            Candidates += (unsigned int)nearby.size();
+
+            float first = 1.0f;
+            glm::vec3 normal(0.0f);
+            for (size_t i = 0; i < nearby.size(); i++)
+                sweep(position, remaining, boxMin[nearby[i]] - Radius, boxMax[nearby[i]] + Radius, first, normal);
+            if (first >= 1.0f)
+            {
+                position = end;
+                break;
+            }
+            // stop short of the surface, then slide what is left of the move along it
+            position += remaining * first + normal * SKIN;
+            remaining *= 1.0f - first;
+            remaining -= normal * glm::dot(remaining, normal);
+            Slides++;
+        }
+        Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Moves++;
+        TotalSeconds += Seconds;
+        MaxSeconds = std::max(MaxSeconds, Seconds);
+        return position;
+    }
+
+    void report() const
+    {
+        std::cout << "camera collision: " << Boxes << " boxes; " << Moves << " moves, " << 1.0e6 * (Moves ? TotalSeconds / Moves : 0.0)
+            << " us on average, " << 1.0e6 * MaxSeconds << " us at most" << std::endl;
+    }
+
+private:
+    enum { MAX_SLIDES = 3 };
+    // gap kept between the eye's sphere and a surface it stopped at
+    static constexpr float SKIN = 1e-3f;
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    size_t boxIndices;
+    std::vector<glm::vec3> boxMin;
+    std::vector<glm::vec3> boxMax;
+    SpatialHashGrid grid;
+    std::vector<uint32_t> nearby;
+
+    // ray from origin along delta against [min, max]: lowers first (fraction of delta) and sets
+    // normal when it enters the box before first; starting inside is no hit
+    static void sweep(const glm::vec3& origin, const glm::vec3& delta, const glm::vec3& min, const glm::vec3& max, float& first, glm::vec3& normal)
+    {
+        float enter = -1e30f, exit = 1e30f;
+        int axis = -1;
+        for (int k = 0; k < 3; k++)
+        {
+            if (std::fabs(delta[k]) < 1e-12f)
+            {
+                if (origin[k] < min[k] || origin[k] > max[k])
+                    return;
+                continue;
+            }
+            float t0 = (min[k] - origin[k]) / delta[k], t1 = (max[k] - origin[k]) / delta[k];
+            if (t0 > t1)
+                std::swap(t0, t1);
+            if (t0 > enter)
+            {
+                enter = t0;
+                axis = k;
+            }
+            exit = std::min(exit, t1);
+        }
+        if (axis < 0 || enter > exit || enter < 0.0f || enter >= first)
+            return;
+        first = enter;
+        normal = glm::vec3(0.0f);
+        normal[axis] = delta[axis] > 0.0f ? -1.0f : 1.0f;
+    }
+};
+
+#endif
@@ -0,0 +1,519 @@
+#pragma once
+
+//
+//  draw_queue.h
+//  3D Object Drawing
+//
+
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "../common/gl_state.h"
+#include "occlusion_culler.h"
+#include "shader.h"
+#include "shader_variants.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+enum Draw_Pass {
+    DRAW_PASS_MAIN,
+    DRAW_PASS_OVERLAY
+};
+
+// a shader variant; resolved at submission so the submitter may add features of its own
+struct DrawProgram
+{
+    ShaderVariants* variants;
+    unsigned int features;
+
+    bool operator==(const DrawProgram& other) const
+    {
+        return variants == other.variants && features == other.features;
+    }
+    bool operator!=(const DrawProgram& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// firstInstance of a packet that draws a single copy with its own model matrix
+const uint32_t DRAW_NO_INSTANCES = 0xFFFFFFFFu;
+
+// everything one draw call needs, captured when it was recorded
+struct DrawPacket
+{
+    glm::mat4 model;
+    glm::vec4 color;
+    DrawProgram program;
+    unsigned int vertexArray;
+    GLenum mode;
+    GLsizei count;
+    GLenum type;
+    const void* indices;
+    // copies of the draw; an instanced packet keeps their model matrices in the queue
+    // (DrawQueue::instanceModel) and model is its first copy's
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+struct DrawSortItem
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+// LSD radix sort on the 64-bit keys, 8 bits per pass. Byte positions where every key has the
+// same value are skipped, so the unused low bits of the key cost nothing. Stable, so packets
+// with equal keys keep their recording order.
+inline void radixSortDraws(std::vector<DrawSortItem>& items, std::vector<DrawSortItem>& scratch)
+{
+    const size_t n = items.size();
+    if (n < 2)
+        return;
+    scratch.resize(n);
+    DrawSortItem* from = items.data();
+    DrawSortItem* to = scratch.data();
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256] = { 0 };
+        for (size_t i = 0; i < n; i++)
+            counts[(from[i].key >> shift) & 0xFF]++;
+        if (counts[(from[0].key >> shift) & 0xFF] == n)
+            continue;
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            size_t c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; i++)
+            to[counts[(from[i].key >> shift) & 0xFF]++] = from[i];
+        DrawSortItem* swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != items.data())
+        items.swap(scratch);
+}
+
+// Records draws instead of issuing them, then submits the frame in sort key order.
+// Recording mirrors the GL calls it replaces: use(), setModel(), setColor() and
+// bindVertexArray() set the current state, drawElements() snapshots it into a packet, and
+// state not set again carries over to the next draw as it would in GL. With a frustum set,
+// draws whose box (LocalMin..LocalMax under the model matrix) is outside are dropped here,
+// and with an occlusion culler set, those whose box is behind its occluders.
+// drawInstanced() records many copies of the same draw as one packet (prefab parts placed
+// several times); each copy is culled on its own and its matrix kept with the queue.
+//
+// flush() sorts and issues the packets one by one, instanced packets one draw per copy;
+// other submitters (see indirect_draw.h, which draws each instanced packet with a single
+// instanced command) call sort() and walk sorted(i) themselves.
+//
+// Sort key, most significant bits first:
+//  pass (2) | translucent (1) | opaque:      shader (5) | material (16) | depth (24)
+//                             | translucent: far-to-near depth (24) | shader (5) | material (16)
+// Opaque draws are grouped by program and color and go front to back inside each group;
+// with DepthFirst the depth moves above shader and material for strict front to back.
+// Translucent draws always go back to front. Materials are the distinct colors seen so far.
+class DrawQueue
+{
+public:
+    // false: submit in recording order (for comparison)
+    bool Sorted;
+    bool DepthFirst;
+    // model space box of every draw; its center's view depth orders the draw
+    glm::vec3 LocalMin;
+    glm::vec3 LocalMax;
+    // statistics of the last frame; Culled counts frustum and occlusion rejects, Vertices the
+    // indices drawn over all copies
+    unsigned int Culled;
+    unsigned int Draws;
+    unsigned int Instances;
+    unsigned long long Vertices;
+    unsigned int ProgramChanges;
+    unsigned int MaterialChanges;
+    double SortSeconds;
+
+    DrawQueue() : Sorted(true), DepthFirst(false), LocalMin(0.0f), LocalMax(0.0f), Culled(0), Draws(0), Instances(0), Vertices(0), ProgramChanges(0), MaterialChanges(0),
+        SortSeconds(0.0), pass(DRAW_PASS_MAIN), vertexArray(0), model(1.0f), color(0.0f), nearPlane(0.1f), depthScale(1.0f), culling(false), occlusion(nullptr)
+    {
+        program.variants = nullptr;
+        program.features = 0;
+    }
+
+    // start recording a frame seen through view, depths are bucketed between the clip planes
+    void begin(const glm::mat4& view, float nearClip, float farClip)
+    {
+        packets.clear();
+        items.clear();
+        instances.clear();
+        // view space z of a world point, negated so distance in front of the camera is positive
+        viewDepth = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+        nearPlane = nearClip;
+        depthScale = 1.0f / (farClip - nearClip);
+        pass = DRAW_PASS_MAIN;
+        culling = false;
+        occlusion = nullptr;
+        Culled = 0;
+    }
+
+    // cull the draws recorded from now on against six planes, normals pointing inside
+    // (Camera::GetFrustumPlanes); null turns culling off
+    void setFrustum(const glm::vec4* planes)
+    {
+        culling = planes != nullptr;
+        for (int i = 0; culling && i < 6; i++)
+            frustum[i] = planes[i];
+    }
+
+    // test the draws recorded from now on against a rasterized culler's depth pyramid; null
+    // turns it off
+    void setOcclusion(OcclusionCuller* culler)
+    {
+        occlusion = culler;
+    }
+
+    void setPass(Draw_Pass drawPass)
+    {
+        pass = drawPass;
+    }
+
+    void use(ShaderVariants& variants, unsigned int features)
+    {
+        program.variants = &variants;
+        program.features = variants.enabled(features);
+    }
+
+    void bindVertexArray(unsigned int id)
+    {
+        vertexArray = id;
+    }
+
+    void setModel(const glm::mat4& matrix)
+    {
+        model = matrix;
+    }
+
+    void setColor(const glm::vec4& value)
+    {
+        color = value;
+    }
+
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        if ((culling || occlusion) && !isVisible(model))
+        {
+            Culled++;
+            return;
+        }
+        DrawPacket packet = { model, color, program, vertexArray, mode, count, type, indices, DRAW_NO_INSTANCES, 1 };
+        push(packet);
+    }
+
+    // one packet for copies of the current draw, copy i placed at placements[i] * the current
+    // model; the packet sorts by the depth of its first visible copy
+    void drawInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, const glm::mat4* placements, size_t placementCount)
+    {
+        uint32_t first = (uint32_t)instances.size();
+        for (size_t i = 0; i < placementCount; i++)
+        {
+            glm::mat4 matrix = placements[i] * model;
+            if ((culling || occlusion) && !isVisible(matrix))
+            {
+                Culled++;
+                continue;
+            }
+            instances.push_back(matrix);
+        }
+        uint32_t visible = (uint32_t)instances.size() - first;
+        if (visible == 0)
+            return;
+        DrawPacket packet = { instances[first], color, program, vertexArray, mode, count, type, indices, first, visible };
+        if (visible == 1)
+        {
+            packet.firstInstance = DRAW_NO_INSTANCES;
+            instances.pop_back();
+        }
+        push(packet);
+    }
+
+    // order the packets recorded since begin(); recording order is kept when Sorted is off
+    void sort()
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (Sorted)
+            radixSortDraws(items, scratch);
+        SortSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Draws = (unsigned int)items.size();
+        Instances = 0;
+        Vertices = 0;
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            Instances += packets[i].instanceCount;
+            Vertices += (unsigned long long)packets[i].count * packets[i].instanceCount;
+        }
+    }
+
+    size_t size() const
+    {
+        return items.size();
+    }
+
+    // i-th packet in submission order, valid after sort()
+    const DrawPacket& sorted(size_t i) const
+    {
+        return packets[items[i].index];
+    }
+
+    // model matrix of copy i of a packet
+    const glm::mat4& instanceModel(const DrawPacket& packet, uint32_t i) const
+    {
+        return packet.firstInstance == DRAW_NO_INSTANCES ? packet.model : instances[packet.firstInstance + i];
+    }
+
+    // sort and issue everything recorded since begin(), one GL draw per packet and copy
+    void flush()
+    {
+        sort();
+        ProgramChanges = 0;
+        MaterialChanges = 0;
+        const Shader* lastShader = nullptr;
+        glm::vec4 lastColor(-1.0f);
+        for (size_t i = 0; i < items.size(); i++)
+        {
+            const DrawPacket& packet = sorted(i);
+            const Shader* shader = &packet.program.variants->get(packet.program.features);
+            if (shader != lastShader)
+            {
+                shader->use();
+                lastShader = shader;
+                ProgramChanges++;
+            }
+            if (packet.color != lastColor)
+            {
+                lastColor = packet.color;
+                MaterialChanges++;
+            }
+            // the shader's state cache drops values the program already has
+            shader->setVec4("color", packet.color);
+            if (shader->State)
+                shader->State->bindVertexArray(packet.vertexArray);
+            else
+                glBindVertexArray(packet.vertexArray);
+            for (uint32_t copy = 0; copy < packet.instanceCount; copy++)
+            {
+                shader->setMat4("model", instanceModel(packet, copy));
+                glDrawElements(packet.mode, packet.count, packet.type, packet.indices);
+            }
+        }
+    }
+
+private:
+    enum { DEPTH_BITS = 24, SHADER_BITS = 5, MATERIAL_BITS = 16 };
+
+    std::vector<DrawPacket> packets;
+    std::vector<DrawSortItem> items;
+    std::vector<DrawSortItem> scratch;
+    std::vector<glm::mat4> instances;
+    // ids for the key; both only grow, so steady frames do not allocate
+    std::vector<DrawProgram> programs;
+    std::vector<glm::vec4> materials;
+    // current recording state
+    Draw_Pass pass;
+    DrawProgram program;
+    unsigned int vertexArray;
+    glm::mat4 model;
+    glm::vec4 color;
+    glm::vec4 viewDepth;
+    float nearPlane;
+    float depthScale;
+    bool culling;
+    glm::vec4 frustum[6];
+    OcclusionCuller* occlusion;
+
+    void push(const DrawPacket& packet)
+    {
+        DrawSortItem item = { makeKey(packet), (uint32_t)packets.size() };
+        packets.push_back(packet);
+        items.push_back(item);
+    }
+
+    uint64_t makeKey(const DrawPacket& packet)
+    {
+        glm::vec4 center = packet.model * glm::vec4(0.5f * (LocalMin + LocalMax), 1.0f);
+        float depth = (glm::dot(viewDepth, center) - nearPlane) * depthScale;
+        depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+        uint64_t depthBits = (uint64_t)(depth * ((1 << DEPTH_BITS) - 1));
+        uint64_t shaderBits = idOf(programs, packet.program, (1u << SHADER_BITS) - 1);
+        uint64_t materialBits = idOf(materials, packet.color, (1u << MATERIAL_BITS) - 1);
+        bool translucent = packet.color.w < 1.0f;
+
+        uint64_t key = (uint64_t)pass << 62 | (uint64_t)translucent << 61;
+        if (translucent)
+        {
+            uint64_t farToNear = ((1 << DEPTH_BITS) - 1) - depthBits;
+            return key | farToNear << 37 | shaderBits << 32 | materialBits << 16;
+        }
+        if (DepthFirst)
+            return key | depthBits << 37 | shaderBits << 32 | materialBits << 16;
+        return key | shaderBits << 56 | materialBits << 40 | depthBits << 16;
+    }
+
+    // world box of the local box under matrix: center moves, extents go through |rotation*scale|
+    bool isVisible(const glm::mat4& matrix) const
+    {
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(0.5f * (LocalMin + LocalMax), 1.0f));
+        glm::vec3 half = 0.5f * (LocalMax - LocalMin);
+        glm::vec3 extent(0.0f);
+        for (int c = 0; c < 3; c++)
+            extent += glm::abs(glm::vec3(matrix[c])) * half[c];
+        for (int i = 0; culling && i < 6; i++)
+        {
+            glm::vec3 normal(frustum[i]);
+            float radius = glm::dot(glm::abs(normal), extent);
+            if (glm::dot(normal, center) + frustum[i].w < -radius)
+                return false;
+        }
+        return occlusion == nullptr || occlusion->isVisible(center - extent, center + extent);
+    }
+
+    // index of value in table, added on first sight; ids past the limit share the last one
+    template <typename T>
+    static unsigned int idOf(std::vector<T>& table, const T& value, unsigned int limit)
+    {
+        for (size_t i = 0; i < table.size(); i++)
+            if (table[i] == value)
+                return (unsigned int)i;
+        if (table.size() >= limit)
+            return limit;
+        table.push_back(value);
+        return (unsigned int)table.size() - 1;
+    }
+};
+
+// GPU side cost of a section of the frame, measured with queries that are read back a few
+// frames later so the CPU never waits on them:
+//  - GL_SAMPLES_PASSED: fragments that passed the depth test, i.e. were shaded; divided by
+//    the pixel count this is the overdraw (1.0 = every pixel shaded once)
+//  - GL_TIME_ELAPSED: GPU time
+// Results are accumulated per mode (e.g. sorted / unsorted) for report().
+class GpuFrameStats
+{
+public:
+    enum { MODES = 2, LATENCY = 4 };
+
+    GpuFrameStats() : active(-1), next(0)
+    {
+        for (int i = 0; i < MODES; i++)
+        {
+            frames[i] = 0;
+            samples[i] = 0;
+            pixels[i] = 0;
+            nanoseconds[i] = 0;
+        }
+        for (int i = 0; i < LATENCY; i++)
+            slots[i].pending = false;
+        created = false;
+    }
+
+    void begin(int mode)
+    {
+        if (!created)
+        {
+            for (int i = 0; i < LATENCY; i++)
+                glGenQueries(2, slots[i].queries);
+            created = true;
+        }
+        collect();
+        Slot& slot = slots[next];
+        // still in flight after LATENCY frames: skip measuring this one
+        if (slot.pending)
+            return;
+        glBeginQuery(GL_SAMPLES_PASSED, slot.queries[0]);
+        glBeginQuery(GL_TIME_ELAPSED, slot.queries[1]);
+        slot.mode = mode;
+        active = next;
+    }
+
+    void end(unsigned long long pixelCount)
+    {
+        if (active < 0)
+            return;
+        glEndQuery(GL_SAMPLES_PASSED);
+        glEndQuery(GL_TIME_ELAPSED);
+        slots[active].pixels = pixelCount;
+        slots[active].pending = true;
+        active = -1;
+        next = (next + 1) % LATENCY;
+    }
+
+    void report(const char* const names[MODES]) const
+    {
+        for (int i = 0; i < MODES; i++)
+        {
+            if (frames[i] == 0)
+                continue;
+            std::cout << names[i] << ": " << frames[i] << " frames, overdraw " << (double)samples[i] / pixels[i]
+                << " shaded fragments per pixel, " << nanoseconds[i] / 1.0e6 / frames[i] << " ms GPU per frame" << std::endl;
+        }
+    }
+
+    void release()
+    {
+        if (created)
+            for (int i = 0; i < LATENCY; i++)
+                glDeleteQueries(2, slots[i].queries);
+        created = false;
+    }
+
+private:
+    struct Slot
+    {
+        unsigned int queries[2];
+        int mode;
+        unsigned long long pixels;
+        bool pending;
+    };
+
+    Slot slots[LATENCY];
+    bool created;
+    int active;
+    int next;
+    unsigned long long frames[MODES];
+    unsigned long long samples[MODES];
+    unsigned long long pixels[MODES];
+    unsigned long long nanoseconds[MODES];
+
+    void collect()
+    {
+        for (int i = 0; i < LATENCY; i++)
+        {
+            Slot& slot = slots[i];
+            if (!slot.pending)
+                continue;
+            GLuint samplesReady = 0, timeReady = 0;
+            glGetQueryObjectuiv(slot.queries[0], GL_QUERY_RESULT_AVAILABLE, &samplesReady);
+            glGetQueryObjectuiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &timeReady);
+            if (!samplesReady || !timeReady)
+                continue;
+            GLuint passed = 0;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectuiv(slot.queries[0], GL_QUERY_RESULT, &passed);
+            glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &elapsed);
+            frames[slot.mode]++;
+            samples[slot.mode] += passed;
+            pixels[slot.mode] += slot.pixels;
+            nanoseconds[slot.mode] += elapsed;
+            slot.pending = false;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+//
+//  fixed_timestep.h
+//  3D Object Drawing
+//
+
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+// Accumulator clock for a fixed-rate simulation driven by a variable-rate render loop.
+//
+//  clock.advance(glfwGetTime());
+//  while (clock.step())
+//      simulate(clock.Step);             // state at clock.time()
+//  render(clock.alpha());                // blend previous and current state
+//
+// Real time that piles up beyond MaxFrameTime (breakpoint, window drag...) is dropped instead
+// of being replayed as a burst of steps.
+class FixedTimestep
+{
+public:
+    double Step;
+    double MaxFrameTime;
+    unsigned long long Steps;
+
+    FixedTimestep(double rate = 120.0, double maxFrameTime = 0.25) : MaxFrameTime(maxFrameTime), Steps(0),
+        accumulator(0.0), lastTime(0.0), started(false)
+    {
+        setRate(rate);
+    }
+
+    void setRate(double rate)
+    {
+        Step = 1.0 / rate;
+    }
+
+    // restart at time now with nothing accumulated
+    void start(double now)
+    {
+        lastTime = now;
+        accumulator = 0.0;
+        started = true;
+    }
+
+    void advance(double now)
+    {
+        if (!started)
+            start(now);
+        double frameTime = now - lastTime;
+        if (frameTime > MaxFrameTime)
+            frameTime = MaxFrameTime;
+        if (frameTime > 0.0)
+            accumulator += frameTime;
+        lastTime = now;
+    }
+
+    // consume one step if a whole one has accumulated
+    bool step()
+    {
+        if (accumulator < Step)
+            return false;
+        accumulator -= Step;
+        Steps++;
+        return true;
+    }
+
+    // wall clock time the step just taken ends at
+    double time() const
+    {
+        return lastTime - accumulator;
+    }
+
+    // seconds from the last advance() until the next step is due
+    double untilNextStep() const
+    {
+        return Step - accumulator;
+    }
+
+    // how far render time is past the last step, in steps (0..1)
+    float alpha() const
+    {
+        return static_cast<float>(accumulator / Step);
+    }
+
+private:
+    double accumulator;
+    double lastTime;
+    bool started;
+};
+
+#endif
@@ -1,9 +1,33 @@
 #version 330 core
+#if defined(VERTEX_COLOR)
+in vec4 vertexColor;
+#elif defined(DRAW_DATA)
+flat in vec4 drawColor;
+#else
 uniform vec4 color;
+#endif
+#ifdef LIGHTING
+in vec3 worldPos;
+
+// fixed light from above, slightly toward the window
+const vec3 lightDirection = normalize(vec3(-0.4f, 1.0f, 0.3f));
+#endif
 
 out vec4 FragColor;
 
 void main()
 {
-    FragColor = color;
+#if defined(VERTEX_COLOR)
+    vec4 baseColor = vertexColor;
+#elif defined(DRAW_DATA)
+    vec4 baseColor = drawColor;
+#else
+    vec4 baseColor = color;
+#endif
+#ifdef LIGHTING
+    // the cube mesh has no normals: take the face normal from the screen-space derivatives
+    vec3 normal = normalize(cross(dFdx(worldPos), dFdy(worldPos)));
+    baseColor.rgb *= 0.6f + 0.4f * abs(dot(normal, lightDirection));
+#endif
+    FragColor = baseColor;
 }
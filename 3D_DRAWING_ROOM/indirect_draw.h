@@ -0,0 +1,284 @@
+#pragma once
+
+//
+//  indirect_draw.h
+//  3D Object Drawing
+//
+
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "draw_queue.h"
+#include "../common/gl_state.h"
+#include "shader_variants.h"
+#include "stream_buffer.h"
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// glMultiDrawElementsIndirect comes with GL 4.3 or GL_ARB_multi_draw_indirect
+#if defined(GL_VERSION_4_3) || defined(GL_ARB_multi_draw_indirect)
+#define INDIRECT_DRAW_HAS_MULTI_DRAW
+#endif
+
+// true when one call can issue a whole list of commands, each with its own base instance
+inline bool multiDrawIndirectSupported()
+{
+    bool available = false;
+#if defined(GL_VERSION_4_3)
+    available = available || GLAD_GL_VERSION_4_3;
+#endif
+#if defined(GL_ARB_multi_draw_indirect) && defined(GL_ARB_base_instance)
+    // the base instance field is only honored with ARB_base_instance (core in 4.2)
+    available = available || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance);
+#endif
+    return available;
+}
+
+// layout fixed by GL for glDrawElementsIndirect / glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// vertex attribute carrying the draw index into SHADER_DRAW_DATA shaders
+const unsigned int DRAW_INDEX_ATTRIBUTE = 2;
+
+// Submits a DrawQueue with per-draw data in a buffer instead of per-draw uniforms:
+//  - every frame the model matrix and color of each visible copy are streamed into a buffer
+//    texture (5 RGBA32F texels per copy) and fetched in the SHADER_DRAW_DATA variants; a
+//    plain packet is one copy, an instanced packet (DrawQueue::drawInstanced) one per copy
+//  - an instanced attribute holding 0, 1, 2 ... gives each copy its index into that data,
+//    starting at the packet's first copy
+//  - with GL 4.3 / ARB_multi_draw_indirect a DrawElementsIndirectCommand is written per
+//    packet, its base instance set to the first copy's index, and each run of packets
+//    sharing program and VAO is a single glMultiDrawElementsIndirect
+//  - on plain GL 3.3 a CPU loop moves the attribute's start to the first copy instead and
+//    issues one glDrawElementsInstanced per packet
+// Either way no uniform is set per draw, and all copies of a prefab part are one command.
+class IndirectDrawer
+{
+public:
+    // true: glMultiDrawElementsIndirect, false: CPU loop
+    bool MultiDraw;
+    unsigned int MaxDraws;
+    // statistics of the last flush(): packets, their copies, and GL calls (runs of packets)
+    unsigned int Draws;
+    unsigned int Instances;
+    unsigned int Batches;
+
+    // maxDraws counts copies; call with a current context
+    IndirectDrawer(GLStateCache& state, unsigned int maxDraws = 16384) : MultiDraw(false), MaxDraws(maxDraws), Draws(0), Instances(0), Batches(0),
+        state(state), indexBuffer(0), texture(0), clipped(false)
+    {
+        MultiDraw = multiDrawIndirectSupported();
+
+        // the buffer texture spans the whole ring, keep it within the driver's texel limit
+        GLint maxTexels = 65536;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        const unsigned long long bytesPerDraw = DRAW_DATA_TEXELS * 16 + sizeof(DrawElementsIndirectCommand);
+        unsigned long long limit = (unsigned long long)maxTexels * 16 / STREAM_FRAME_REGIONS / bytesPerDraw;
+        if (MaxDraws > limit)
+            MaxDraws = (unsigned int)limit;
+
+        // two allocations per frame, each padded to the stream alignment
+        stream.create(GL_ARRAY_BUFFER, MaxDraws * bytesPerDraw + 256);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, stream.ID);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+        std::vector<GLuint> indices(MaxDraws);
+        for (unsigned int i = 0; i < MaxDraws; i++)
+            indices[i] = i;
+        glGenBuffers(1, &indexBuffer);
+        state.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    }
+
+    ~IndirectDrawer()
+    {
+        release();
+    }
+
+    IndirectDrawer(const IndirectDrawer&) = delete;
+    IndirectDrawer& operator=(const IndirectDrawer&) = delete;
+
+    // give a VAO the per-copy index attribute
+    void attach(unsigned int vertexArray)
+    {
+        state.bindVertexArray(vertexArray);
+        state.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+        glVertexAttribIPointer(DRAW_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(DRAW_INDEX_ATTRIBUTE, 1);
+        glEnableVertexAttribArray(DRAW_INDEX_ATTRIBUTE);
+    }
+
+    // sort the queue and issue it; packets use the SHADER_DRAW_DATA variant of their program
+    void flush(DrawQueue& queue)
+    {
+        queue.sort();
+        Draws = 0;
+        Instances = 0;
+        Batches = 0;
+        // whole packets only, as long as their copies fit
+        size_t count = 0;
+        size_t copies = 0;
+        while (count < queue.size() && copies + queue.sorted(count).instanceCount <= MaxDraws)
+            copies += queue.sorted(count++).instanceCount;
+        if (count < queue.size())
+        {
+            if (!clipped)
+                std::cout << "ERROR::INDIRECT_DRAW::TOO_MANY_DRAWS " << queue.Instances << " copies, drawing the first " << copies << std::endl;
+            clipped = true;
+        }
+        if (count == 0)
+            return;
+
+        stream.beginFrame();
+        StreamAllocation data = stream.allocate(copies * DRAW_DATA_TEXELS * sizeof(glm::vec4));
+        StreamAllocation commands = { nullptr, 0, 0, STREAM_FULL };
+        if (MultiDraw)
+            commands = stream.allocate(count * sizeof(DrawElementsIndirectCommand));
+        if (data.status == STREAM_FULL || (MultiDraw && commands.status == STREAM_FULL))
+        {
+            stream.endFrame();
+            return;
+        }
+
+        // without a mapping both are built in these arrays and uploaded with glBufferSubData
+        if (data.ptr == nullptr)
+            texelStaging.resize(copies * DRAW_DATA_TEXELS);
+        if (MultiDraw && commands.ptr == nullptr)
+            commandStaging.resize(count);
+        glm::vec4* texels = data.ptr ? static_cast<glm::vec4*>(data.ptr) : texelStaging.data();
+        DrawElementsIndirectCommand* command = nullptr;
+        if (MultiDraw)
+            command = commands.ptr ? static_cast<DrawElementsIndirectCommand*>(commands.ptr) : commandStaging.data();
+        GLuint firstCopy = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const DrawPacket& packet = queue.sorted(i);
+            for (uint32_t copy = 0; copy < packet.instanceCount; copy++)
+            {
+                const glm::mat4& model = queue.instanceModel(packet, copy);
+                texels[0] = model[0];
+                texels[1] = model[1];
+                texels[2] = model[2];
+                texels[3] = model[3];
+                texels[4] = packet.color;
+                texels += DRAW_DATA_TEXELS;
+            }
+            if (command)
+            {
+                command->count = packet.count;
+                command->instanceCount = packet.instanceCount;
+                command->firstIndex = (GLuint)((uintptr_t)packet.indices / indexSize(packet.type));
+                command->baseVertex = 0;
+                command->baseInstance = firstCopy;
+                command++;
+            }
+            firstCopy += packet.instanceCount;
+        }
+        if (data.ptr == nullptr)
+            stream.write(data, 0, texelStaging.data(), data.size);
+        if (MultiDraw && commands.ptr == nullptr)
+            stream.write(commands, 0, commandStaging.data(), commands.size);
+        stream.commit();
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+#ifdef INDIRECT_DRAW_HAS_MULTI_DRAW
+        if (MultiDraw)
+            state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.ID);
+#endif
+        // this frame's data starts this many texels into the buffer texture
+        const int base = (int)(data.offset / sizeof(glm::vec4));
+
+        firstCopy = 0;
+        for (size_t first = 0; first < count; )
+        {
+            const DrawPacket& packet = queue.sorted(first);
+            size_t last = first + 1;
+            while (last < count && sameBatch(queue.sorted(last), packet))
+                last++;
+
+            const Shader& shader = packet.program.variants->get(packet.program.features | SHADER_DRAW_DATA);
+            shader.use();
+            shader.setInt("drawData", 0);
+            shader.setInt("drawDataBase", base);
+            state.bindVertexArray(packet.vertexArray);
+#ifdef INDIRECT_DRAW_HAS_MULTI_DRAW
+            if (MultiDraw)
+                glMultiDrawElementsIndirect(packet.mode, packet.type,
+                    (const void*)(commands.offset + first * sizeof(DrawElementsIndirectCommand)), (GLsizei)(last - first), 0);
+#endif
+            if (!MultiDraw)
+                state.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+            for (size_t i = first; i < last; i++)
+            {
+                const DrawPacket& draw = queue.sorted(i);
+                if (!MultiDraw)
+                {
+                    // the VAO's index attribute now starts at this packet's first copy
+                    glVertexAttribIPointer(DRAW_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (const void*)(uintptr_t)(firstCopy * sizeof(GLuint)));
+                    glDrawElementsInstanced(draw.mode, draw.count, draw.type, draw.indices, (GLsizei)draw.instanceCount);
+                }
+                firstCopy += draw.instanceCount;
+            }
+            Batches++;
+            first = last;
+        }
+        Draws = (unsigned int)count;
+        Instances = (unsigned int)copies;
+        stream.endFrame();
+    }
+
+    void release()
+    {
+        stream.release();
+        if (texture)
+            glDeleteTextures(1, &texture);
+        if (indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+        texture = 0;
+        indexBuffer = 0;
+    }
+
+    void report() const
+    {
+        std::cout << "indirect draws (" << (MultiDraw ? "glMultiDrawElementsIndirect" : "CPU loop") << "): "
+            << Draws << " draws of " << Instances << " copies in " << Batches << " batches" << std::endl;
+    }
+
+private:
+    enum { DRAW_DATA_TEXELS = 5 };
+
+    GLStateCache& state;
+    StreamBuffer stream;
+    std::vector<glm::vec4> texelStaging;
+    std::vector<DrawElementsIndirectCommand> commandStaging;
+    unsigned int indexBuffer;
+    unsigned int texture;
+    bool clipped;
+
+    static bool sameBatch(const DrawPacket& a, const DrawPacket& b)
+    {
+        return a.program == b.program && a.vertexArray == b.vertexArray && a.mode == b.mode && a.type == b.type;
+    }
+
+    static GLuint indexSize(GLenum type)
+    {
+        return type == GL_UNSIGNED_BYTE ? 1 : (type == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+};
+
+#endif
@@ -0,0 +1,326 @@
+#pragma once
+
+//
+//  input_system.h
+//  3D Object Drawing
+//
+
+#ifndef INPUT_SYSTEM_H
+#define INPUT_SYSTEM_H
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+
+// Bounded single-producer / single-consumer queue. One thread pushes, one thread pops, no locks.
+// Capacity must be a power of two; one slot is kept free to tell full from empty.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : head(0), tail(0)
+    {
+    }
+
+    // producer side; false when the queue is full
+    bool push(const T& item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) & (Capacity - 1);
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+        items[t] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false when the queue is empty
+    bool pop(T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[h];
+        head.store((h + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; look at the next item without removing it
+    const T* peek() const
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &items[h];
+    }
+
+private:
+    T items[Capacity];
+    // producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+enum Input_Event_Type {
+    INPUT_KEY,
+    INPUT_CURSOR,
+    INPUT_SCROLL,
+    INPUT_BUTTON
+};
+
+// one GLFW callback, stamped with glfwGetTime() when it arrived
+struct InputEvent
+{
+    Input_Event_Type type;
+    int key;
+    int action;
+    double x;
+    double y;
+    double time;
+};
+
+const size_t INPUT_QUEUE_SIZE = 1024;
+
+// GLFW callbacks only push timestamped events into a lock-free queue; nothing is polled per key.
+// The simulation drains the queue once per fixed tick with beginTick() and then reads
+//  - continuous state:   isDown(key), mouseDelta(), scrollDelta(), cursorPosition()
+//  - edge-triggered:     wasPressed(key) / wasClicked(button) is true only on the tick that saw the press
+// Events newer than the tick being simulated stay queued for the next one, so input is
+// applied at the tick it happened in. Because producer and consumer only meet in the queue,
+// the simulation may also run on its own thread.
+//
+// notePresented() after SwapBuffers measures event -> present latency for every consumed event.
+class InputSystem
+{
+public:
+    // events lost because the queue was full
+    unsigned int DroppedEvents;
+
+    InputSystem() : DroppedEvents(0), heldKeys(0), cursorValid(false), cursorX(0.0), cursorY(0.0), mouse(0.0f), scroll(0.0f),
+        pendingEvents(0), pendingTimeSum(0.0), pendingOldest(0.0), latencyEvents(0), latencySum(0.0), latencyMax(0.0)
+    {
+        for (int i = 0; i <= GLFW_KEY_LAST; i++)
+        {
+            down[i] = false;
+            pressed[i] = false;
+        }
+        for (int i = 0; i <= GLFW_MOUSE_BUTTON_LAST; i++)
+        {
+            clicked[i] = false;
+            clickX[i] = 0.0;
+            clickY[i] = 0.0;
+        }
+    }
+
+    // installs the callbacks; replaces any key/cursor/scroll/button callback set on the window before
+    void attach(GLFWwindow* window)
+    {
+        glfwSetWindowUserPointer(window, this);
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetCursorPosCallback(window, cursorCallback);
+        glfwSetScrollCallback(window, scrollCallback);
+        glfwSetMouseButtonCallback(window, buttonCallback);
+    }
+
+    // producer side, called from the GLFW callbacks
+    void post(Input_Event_Type type, int key, int action, double x, double y)
+    {
+        InputEvent e = { type, key, action, x, y, glfwGetTime() };
+        if (!queue.push(e))
+            DroppedEvents++;
+    }
+
+    // consumer side: start a simulation tick ending at tickTime and apply every event up to it
+    void beginTick(double tickTime)
+    {
+        for (int i = 0; i <= GLFW_KEY_LAST; i++)
+            pressed[i] = false;
+        for (int i = 0; i <= GLFW_MOUSE_BUTTON_LAST; i++)
+            clicked[i] = false;
+        mouse = glm::vec2(0.0f);
+        scroll = glm::vec2(0.0f);
+
+        const InputEvent* next;
+        while ((next = queue.peek()) != nullptr && next->time <= tickTime)
+        {
+            InputEvent e;
+            queue.pop(e);
+            apply(e);
+        }
+    }
+
+    bool isDown(int key) const
+    {
+        return key >= 0 && key <= GLFW_KEY_LAST && down[key];
+    }
+
+    // any key held at the end of the tick (held keys keep changing state without new events)
+    bool anyKeyDown() const
+    {
+        return heldKeys > 0;
+    }
+
+    bool wasPressed(int key) const
+    {
+        return key >= 0 && key <= GLFW_KEY_LAST && pressed[key];
+    }
+
+    // cursor movement during the tick, y up
+    glm::vec2 mouseDelta() const
+    {
+        return mouse;
+    }
+
+    glm::vec2 scrollDelta() const
+    {
+        return scroll;
+    }
+
+    // cursor in window coordinates (pixels from the top left) at the end of the tick
+    glm::vec2 cursorPosition() const
+    {
+        return glm::vec2(static_cast<float>(cursorX), static_cast<float>(cursorY));
+    }
+
+    bool wasClicked(int button) const
+    {
+        return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && clicked[button];
+    }
+
+    // where the cursor was when button was last pressed, in window coordinates
+    glm::vec2 clickPosition(int button) const
+    {
+        if (button < 0 || button > GLFW_MOUSE_BUTTON_LAST)
+            return glm::vec2(0.0f);
+        return glm::vec2(static_cast<float>(clickX[button]), static_cast<float>(clickY[button]));
+    }
+
+    // call right after SwapBuffers: everything consumed since the last call is now on screen
+    void notePresented(double presentTime)
+    {
+        if (pendingEvents == 0)
+            return;
+        latencySum += pendingEvents * presentTime - pendingTimeSum;
+        if (presentTime - pendingOldest > latencyMax)
+            latencyMax = presentTime - pendingOldest;
+        latencyEvents += pendingEvents;
+        pendingEvents = 0;
+        pendingTimeSum = 0.0;
+    }
+
+    void report() const
+    {
+        if (latencyEvents == 0)
+            return;
+        std::cout << "input latency: " << latencyEvents << " events, avg " << 1000.0 * latencySum / latencyEvents
+            << " ms, max " << 1000.0 * latencyMax << " ms (event to SwapBuffers), " << DroppedEvents << " dropped" << std::endl;
+    }
+
+private:
+    SpscQueue<InputEvent, INPUT_QUEUE_SIZE> queue;
+    bool down[GLFW_KEY_LAST + 1];
+    bool pressed[GLFW_KEY_LAST + 1];
+    bool clicked[GLFW_MOUSE_BUTTON_LAST + 1];
+    double clickX[GLFW_MOUSE_BUTTON_LAST + 1];
+    double clickY[GLFW_MOUSE_BUTTON_LAST + 1];
+    int heldKeys;
+    bool cursorValid;
+    double cursorX;
+    double cursorY;
+    glm::vec2 mouse;
+    glm::vec2 scroll;
+    // latency bookkeeping
+    unsigned int pendingEvents;
+    double pendingTimeSum;
+    double pendingOldest;
+    unsigned long long latencyEvents;
+    double latencySum;
+    double latencyMax;
+
+    void apply(const InputEvent& e)
+    {
+        if (pendingEvents == 0)
+            pendingOldest = e.time;
+        pendingEvents++;
+        pendingTimeSum += e.time;
+
+        switch (e.type)
+        {
+        case INPUT_KEY:
+            if (e.key < 0 || e.key > GLFW_KEY_LAST || e.action == GLFW_REPEAT)
+                break;
+            if (e.action == GLFW_PRESS)
+            {
+                if (!down[e.key])
+                {
+                    pressed[e.key] = true;
+                    heldKeys++;
+                }
+                down[e.key] = true;
+            }
+            else if (down[e.key])
+            {
+                down[e.key] = false;
+                heldKeys--;
+            }
+            break;
+        case INPUT_CURSOR:
+            // the first position only sets the reference point
+            if (cursorValid)
+            {
+                mouse.x += static_cast<float>(e.x - cursorX);
+                mouse.y += static_cast<float>(cursorY - e.y); // reversed since y-coordinates go from bottom to top
+            }
+            cursorX = e.x;
+            cursorY = e.y;
+            cursorValid = true;
+            break;
+        case INPUT_SCROLL:
+            scroll.x += static_cast<float>(e.x);
+            scroll.y += static_cast<float>(e.y);
+            break;
+        case INPUT_BUTTON:
+            if (e.key < 0 || e.key > GLFW_MOUSE_BUTTON_LAST || e.action != GLFW_PRESS)
+                break;
+            clicked[e.key] = true;
+            clickX[e.key] = e.x;
+            clickY[e.key] = e.y;
+            break;
+        }
+    }
+
+    static InputSystem* from(GLFWwindow* window)
+    {
+        return static_cast<InputSystem*>(glfwGetWindowUserPointer(window));
+    }
+
+    static void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/)
+    {
+        from(window)->post(INPUT_KEY, key, action, 0.0, 0.0);
+    }
+
+    static void cursorCallback(GLFWwindow* window, double xpos, double ypos)
+    {
+        from(window)->post(INPUT_CURSOR, 0, 0, xpos, ypos);
+    }
+
+    static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+    {
+        from(window)->post(INPUT_SCROLL, 0, 0, xoffset, yoffset);
+    }
+
+    // the cursor position goes with the press, the queue may still hold moves before it
+    static void buttonCallback(GLFWwindow* window, int button, int action, int /*mods*/)
+    {
+        double x, y;
+        glfwGetCursorPos(window, &x, &y);
+        from(window)->post(INPUT_BUTTON, button, action, x, y);
+    }
+};
+
+#endif
@@ -12,35 +12,111 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// print whether the shader program came from the binary cache (warm) or was compiled (cold)
+//#define ROOM_REPORT_SHADER_CACHE
+//#define ROOM_REPORT_GL_STATE
+#include "../common/gl_state.h"
 #include "shader.h"
+//#define ROOM_REPORT_SHADER_VARIANTS
+// diffuse shading on the prototypes room.scene marks lit (without it the room is drawn unlit)
+//#define ROOM_LIGHTING
+#include "shader_variants.h"
+// edits to the shader files are compiled in the background and swapped in while running
+#define ROOM_SHADER_HOT_RELOAD
+#include "shader_reload.h"
+// quaternion camera: roll is applied and pitch is unlimited (default is the yaw/pitch camera)
+//#define ROOM_QUATERNION_CAMERA
 #include "camera.h"
 #include "basic_camera.h"
+#include "stream_buffer.h"
+#include "input_system.h"
+#include "fixed_timestep.h"
+#include "../common/frame_pacing.h"
+
+// allocation-check build: count heap allocations and fail if a steady-state frame allocates
+//#define ROOM_COUNT_ALLOCATIONS
+#include "alloc_counter.h"
+
+// benchmark build: compare batched affine transforms against per-object glm::mat4 math and exit
+//#define ROOM_BENCH_TRANSFORMS
+#include "transform_batch.h"
+#include "transform_hierarchy.h"
+// benchmark build: rebuild, query and cull a spatial hash grid of up to 1M moving boxes and exit
+//#define ROOM_BENCH_SPATIAL_GRID
+#include "spatial_hash_grid.h"
+
+// measure overdraw and GPU time of the room with sorted and recording-order submission
+//#define ROOM_REPORT_DRAW_ORDER
+#include "draw_queue.h"
+// per-draw matrices and colors from a buffer texture, one glMultiDrawElementsIndirect per
+// program (GL 4.3), a CPU loop without uniform changes otherwise
+#define ROOM_INDIRECT_DRAWS
+#ifdef ROOM_INDIRECT_DRAWS
+#include "indirect_draw.h"
+#endif
+// occlusion culling: walls, ceilings, slabs and big furniture are rasterized on the CPU into a
+// small depth buffer and draws hidden behind them are dropped before submission
+//#define ROOM_OCCLUSION_CULLING
+// print the share of draws occlusion culling rejected and its cost; F3 switches it off and on
+//#define ROOM_REPORT_OCCLUSION
+#include "occlusion_culler.h"
+// portal visibility: only the rooms seen from the camera's room through windows and open sides
+// are recorded (scene cells and portals); F4 switches it off and on
+//#define ROOM_PORTAL_CULLING
+// print how many rooms portal visibility let through and what walking the portals cost
+//#define ROOM_REPORT_PORTALS
+#include "portal_visibility.h"
+// camera collision: the eye is kept out of the walls, floor and furniture and slides along them
+#define ROOM_CAMERA_COLLISION
+// print what keeping the camera out of the scene cost per move
+//#define ROOM_REPORT_COLLISION
+#include "camera_collision.h"
+// picking: a left click prints the object under the cursor, found by a ray cast through a BVH
+#define ROOM_PICKING
+#include "object_picker.h"
+// picking on the rendered image: a right click draws object ids under the cursor into an integer
+// buffer, read back a frame or two later without stalling the GPU (left clicks stay with ROOM_PICKING)
+//#define ROOM_GPU_PICKING
+#include "object_id_pass.h"
+// print how the room scene was loaded (compiled from text or read from the binary) and its size
+//#define ROOM_REPORT_SCENE
+#include "scene.h"
+// draw the cups as the seven cubes they used to be instead of one generated mesh, to compare
+//#define ROOM_CUBE_CUPS
+// print the draws and vertices per frame, and the meshes the atlas holds
+//#define ROOM_REPORT_DRAW_COUNTS
+#include "mesh_library.h"
+// stress build: draw room.scene tiled into a generated building (BUILDING_* below) instead of the room
+//#define ROOM_GENERATED_BUILDING
+// benchmark build: generate buildings of 1 to 10,000 rooms, time their per-frame CPU work with
+// frustum culling only, with occlusion culling and with portal visibility, and exit
+//#define ROOM_BENCH_BUILDING
+#include "building_generator.h"
 
 #include <iostream>
 
 using namespace std;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void window_refresh_callback(GLFWwindow* window);
 void processInput(GLFWwindow* window);
-void drawBookself(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawTable(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawChair(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawCup(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawSofa(unsigned int VAO, Shader ourShader);
-void drawTelevision(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawFan(unsigned int VAO, Shader ourShader, glm::mat4 matr, float r);
-void drawOuterWall(unsigned int VAO, Shader ourShader);
-void drawFrame(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-void drawWindow(unsigned int VAO, Shader ourShader);
-void drawFloor(unsigned int VAO, Shader ourShader, glm::mat4 matr);
-
+void updateSimulation(float dt);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// uniform block binding point of the per-frame FrameData block (see vertexShader.vs)
+const unsigned int FRAME_DATA_BINDING = 0;
+
+#ifdef ROOM_GENERATED_BUILDING
+// size and seed of the generated building; the same values always give the same building
+const unsigned int BUILDING_ROOMS = 100;
+const unsigned int BUILDING_FLOORS = 4;
+const unsigned int BUILDING_EXTRA_FURNITURE = 4;
+const uint64_t BUILDING_SEED = 1;
+#endif
+
 // modelling transform
 float rotateAngle_X = 45.0;
 float rotateAngle_Y = 45.0;
@@ -56,14 +132,65 @@ float scale_Y = 1.0;
 float scale_Z = 1.0;
 
 //global var for fan
-float r = 0.0f;
+// scene animations (the fan's spin in room.scene) run on this clock, which only advances while the fan is on
+double sceneTime = 0.0;             // seconds at the current simulation step
+double sceneTimePrevious = 0.0;     // at the step before, rendering blends between the two
 bool fanOn = false;
 
-// camera
+// camera: input moves camera once per simulation step; frames are drawn from viewCamera, placed
+// between the pose before the last step and the pose after it like sceneTime
 Camera camera(glm::vec3(-3.5f, 2.5f, 1.5f));
-float lastX = SCR_WIDTH / 2.0f;
-float lastY = SCR_HEIGHT / 2.0f;
-bool firstMouse = true;
+Camera viewCamera;
+CameraPose cameraPrevious;
+
+// input: callbacks feed the queue, processInput() consumes it once per simulation step
+//#define ROOM_REPORT_INPUT_LATENCY
+InputSystem input;
+
+// simulation: input, camera and animation advance in fixed steps of 1 / SIMULATION_RATE seconds
+const double SIMULATION_RATE = 120.0;
+FixedTimestep simulationClock(SIMULATION_RATE);
+
+// frame pacing: frames that would look like the last one are not drawn and the loop sleeps in
+// glfwWaitEventsTimeout instead; TARGET_FPS > 0 additionally caps the drawn frame rate
+//#define ROOM_REPORT_FRAME_PACING
+const double TARGET_FPS = 0.0;
+FramePacer framePacer(TARGET_FPS);
+
+// shadow of the bound program/VAO/buffers, uniform values and fixed-function state; redundant
+// calls (the same VAO before every draw, unchanged colors) never reach the driver
+GLStateCache glState;
+
+// draws are recorded into packets and submitted sorted by program, color and depth;
+// F2 switches to recording order for comparison
+DrawQueue drawQueue;
+
+#ifdef ROOM_OCCLUSION_CULLING
+OcclusionCuller occlusionCuller;
+bool occlusionCulling = true;
+#endif
+
+#ifdef ROOM_PORTAL_CULLING
+PortalVisibility portalVisibility;
+bool portalCulling = true;
+#endif
+
+#ifdef ROOM_CAMERA_COLLISION
+CameraCollider cameraCollider;
+#endif
+
+#ifdef ROOM_PICKING
+ObjectPicker objectPicker;
+// the ray of the last click, cast by the frame loop against what was on screen
+PickRay pickRay;
+bool pickPending = false;
+#endif
+
+#ifdef ROOM_GPU_PICKING
+// the last click in framebuffer pixels, drawn into the id pass by the next frame
+glm::ivec2 idPixel;
+bool idPickPending = false;
+#endif
 
 float eyeX = -5.0, eyeY = 3.5, eyeZ = 3.0;
 float lookAtX = 0.0, lookAtY = 0.0, lookAtZ = 0.0;
@@ -71,11 +198,19 @@ glm::vec3 V = glm::vec3(0.0f, 1.0f, 0.0f);
 BasicCamera basic_camera(eyeX, eyeY, eyeZ, lookAtX, lookAtY, lookAtZ, V);
 
 // timing
-float deltaTime = 0.0f;    // time between current frame and last frame
-float lastFrame = 0.0f;
+float deltaTime = static_cast<float>(1.0 / SIMULATION_RATE);    // length of one simulation step
 
 int main()
 {
+#ifdef ROOM_BENCH_TRANSFORMS
+    benchmarkTransformBatch();
+    return 0;
+#endif
+#ifdef ROOM_BENCH_SPATIAL_GRID
+    benchmarkSpatialGrid();
+    return 0;
+#endif
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -98,8 +233,14 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    camera.SetPerspective((float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+#ifdef ROOM_QUATERNION_CAMERA
+    camera.SetMode(QUATERNION_CAMERA);
+#endif
+    cameraPrevious = camera.GetPose();
+    viewCamera.SetPose(cameraPrevious);
+    input.attach(window);
 
     // tell GLFW to capture our mouse
     //glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -114,11 +255,50 @@ int main()
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    glState.enable(GL_DEPTH_TEST);
 
     // build and compile our shader zprogram
+    // linked programs are cached on disk, later launches skip compiling until a shader or the driver changes
     // ------------------------------------
-    Shader ourShader("vertexShader.vs", "fragmentShader.fs");
+    // only the variants the room draws with are compiled: lit furniture, unlit walls/floor/window
+    ProgramCache programCache;
+    ShaderVariants roomShaders("vertexShader.vs", "fragmentShader.fs", &programCache);
+    roomShaders.setUniformBlock("FrameData", FRAME_DATA_BINDING);
+    roomShaders.trackState(&glState);
+#ifndef ROOM_LIGHTING
+    roomShaders.Disabled = SHADER_LIGHTING;
+#endif
+    // the cube mesh spans [0, 0.5] on every axis
+    drawQueue.LocalMin = glm::vec3(0.0f);
+    drawQueue.LocalMax = glm::vec3(0.5f);
+#ifdef ROOM_REPORT_DRAW_ORDER
+    GpuFrameStats drawOrderStats;
+#endif
+#ifdef ROOM_GPU_PICKING
+    ObjectIdPass objectIdPass(glState, "objectId.vs", "objectId.fs", FRAME_DATA_BINDING, &programCache);
+    objectIdPass.LocalMin = drawQueue.LocalMin;
+    objectIdPass.LocalMax = drawQueue.LocalMax;
+    // frames drawn so far, to tell how late an id came back
+    unsigned long long frameNumber = 0;
+#endif
+#ifdef ROOM_INDIRECT_DRAWS
+    roomShaders.prepare(SHADER_LIGHTING | SHADER_DRAW_DATA);
+    roomShaders.prepare(SHADER_LIGHTING | SHADER_VERTEX_COLOR | SHADER_DRAW_DATA);
+    roomShaders.prepare(SHADER_DRAW_DATA);
+#else
+    roomShaders.prepare(SHADER_LIGHTING);
+    roomShaders.prepare(SHADER_LIGHTING | SHADER_VERTEX_COLOR);
+    roomShaders.prepare(0);
+#endif
+#ifdef ROOM_REPORT_SHADER_CACHE
+    programCache.report();
+#endif
+#ifdef ROOM_SHADER_HOT_RELOAD
+    ShaderReloader shaderReloader(window, roomShaders);
+#endif
+
+    // ring buffer for everything that changes per frame (camera block today, instance data later)
+    StreamBuffer frameStream(GL_UNIFORM_BUFFER, 64 * 1024);
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -192,6 +372,33 @@ int main()
         20, 21, 22,
         22, 23, 20
     };
+    // everything draws from one vertex and index buffer: the cube first, so the scene's index
+    // ranges into it stay valid, then the meshes room.scene describes
+    MeshLibrary meshes;
+    meshes.add("cube", cube_vertices, sizeof(cube_vertices) / (6 * sizeof(float)), 6, cube_indices, sizeof(cube_indices) / sizeof(cube_indices[0]));
+
+    // furniture, walls and floor come from the scene file; the first load compiles it to room.scene.bin
+    Scene roomScene;
+    if (!roomScene.load("room.scene") || !roomScene.buildMeshes(meshes) || !roomScene.useMeshes(meshes))
+    {
+        glfwTerminate();
+        return -1;
+    }
+#ifdef ROOM_CUBE_CUPS
+    roomScene.replacePrototype("cup", "cup_cubes");
+#endif
+#ifdef ROOM_REPORT_SCENE
+    roomScene.report("room.scene");
+#endif
+#ifdef ROOM_REPORT_DRAW_COUNTS
+    meshes.report();
+#endif
+#ifdef ROOM_BENCH_BUILDING
+    // the occlusion half of the benchmark rasterizes these meshes
+    benchmarkBuilding(meshes);
+    glfwTerminate();
+    return 0;
+#endif
     /*unsigned int cube_indices[] = {
         0, 3, 2,
         2, 1, 0,
@@ -272,13 +479,13 @@ int main()
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
 
-    glBindVertexArray(VAO);
+    glState.bindVertexArray(VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cube_vertices), cube_vertices, GL_STATIC_DRAW);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, meshes.vertexCount() * MeshLibrary::STRIDE * sizeof(float), meshes.vertexData(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshes.indexCount() * sizeof(unsigned int), meshes.indexData(), GL_STATIC_DRAW);
 
     // position attribute
    // glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -292,6 +499,14 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
     glEnableVertexAttribArray(1);
 
+#ifdef ROOM_OCCLUSION_CULLING
+    occlusionCuller.setMesh(meshes.vertexData(), meshes.vertexCount(), MeshLibrary::STRIDE, meshes.indexData(), meshes.indexCount());
+#endif
+#if defined(ROOM_REPORT_OCCLUSION) && defined(ROOM_OCCLUSION_CULLING)
+    // CPU time from recording to submission, [0] without and [1] with occlusion culling
+    double occlusionFrameSeconds[2] = { 0.0, 0.0 };
+    unsigned int occlusionFrames[2] = { 0, 0 };
+#endif
 
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
@@ -299,90 +514,213 @@ int main()
 
     //ourShader.use();
 
+#ifdef ROOM_GENERATED_BUILDING
+    {
+        // the loaded room becomes the template of the building that replaces it
+        Scene building;
+        BuildingGenerator generator;
+        if (!generator.generate(roomScene, BuildingConfig(BUILDING_ROOMS, BUILDING_FLOORS, BUILDING_EXTRA_FURNITURE, BUILDING_SEED), building))
+        {
+            glfwTerminate();
+            return -1;
+        }
+        generator.report();
+        std::swap(roomScene, building);
+    }
+#endif
+#ifdef ROOM_INDIRECT_DRAWS
+#ifdef ROOM_GENERATED_BUILDING
+    // a frame never draws more copies than the building places, an eighth more leaves room to edit it
+    size_t buildingDraws = roomScene.placedParts();
+    IndirectDrawer indirectDrawer(glState, (unsigned int)(buildingDraws + buildingDraws / 8));
+#else
+    IndirectDrawer indirectDrawer(glState);
+#endif
+    indirectDrawer.attach(VAO);
+#endif
+    TransformHierarchy roomTransforms;
+    SceneInstance roomInstance = roomScene.instantiate(roomTransforms);
+#ifdef ROOM_PORTAL_CULLING
+    // the rooms never move, their cells are placed once
+    roomTransforms.update();
+    roomScene.buildVisibility(roomInstance, roomTransforms, portalVisibility);
+#endif
+#ifdef ROOM_CAMERA_COLLISION
+    // only what never moves collides, so the boxes are collected once
+    roomTransforms.update();
+    cameraCollider.setMesh(meshes.vertexData(), meshes.vertexCount(), MeshLibrary::STRIDE, meshes.indexData(), meshes.indexCount(), meshes.mesh(0).indexCount);
+    roomScene.addColliders(roomInstance, roomTransforms, cameraCollider);
+    cameraCollider.build();
+#endif
+#ifdef ROOM_PICKING
+    roomTransforms.update();
+    objectPicker.setMesh(meshes.vertexData(), meshes.vertexCount(), MeshLibrary::STRIDE, meshes.indexData(), meshes.indexCount(), meshes.mesh(0).indexCount);
+    objectPicker.build(roomScene, roomInstance, roomTransforms);
+#endif
+
+#ifdef ROOM_COUNT_ALLOCATIONS
+    AllocationFrameCheck allocCheck;
+#endif
+
+#ifdef ROOM_REPORT_DRAW_COUNTS
+    unsigned long long countedFrames = 0, countedDraws = 0, countedCopies = 0, countedVertices = 0;
+#endif
+
+    double renderedSceneTime = sceneTime;
+    unsigned int renderedCameraVersion = viewCamera.GetVersion();
+    simulationClock.start(glfwGetTime());
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
+#ifdef ROOM_COUNT_ALLOCATIONS
+        allocCheck.beginFrame(glfwGetTime());
+#endif
+        // simulation: run every fixed step up to now, each one sees only the input events that happened before it ended
+        // ----------
+        simulationClock.advance(glfwGetTime());
+        while (simulationClock.step())
+        {
+            cameraPrevious = camera.GetPose();
+            input.beginTick(simulationClock.time());
+            processInput(window);
+            updateSimulation(deltaTime);
+        }
+#ifdef ROOM_PICKING
+        // world matrices are still those of the frame on screen when the click happened
+        if (pickPending)
+        {
+            pickPending = false;
+            objectPicker.refresh(roomTransforms);
+            PickHit hit = objectPicker.pick(pickRay);
+            if (hit.node == Scene::NONE)
+                std::cout << "picked nothing" << std::endl;
+            else
+                std::cout << "picked " << roomScene.name(roomScene.Nodes[hit.node].name) << " at " << hit.distance << " m" << std::endl;
+        }
+#endif
+#ifdef ROOM_GPU_PICKING
+        ObjectIdResult idResult;
+        if (objectIdPass.poll(frameNumber, idResult))
+        {
+            if (idResult.id == 0 || idResult.id > roomScene.Nodes.size())
+                std::cout << "id pass picked nothing";
+            else
+                std::cout << "id pass picked " << roomScene.name(roomScene.Nodes[idResult.id - 1].name);
+            std::cout << ", " << idResult.frames << " frames after the click" << std::endl;
+        }
+#endif
+#ifdef ROOM_SHADER_HOT_RELOAD
+        // a rebuilt program is swapped in here; a shader with errors keeps the old one running
+        if (shaderReloader.update())
+            framePacer.requestRedraw();
+#endif
+        float alpha = simulationClock.alpha();
+        double animationTime = sceneTimePrevious + (sceneTime - sceneTimePrevious) * alpha;
+        CameraPose cameraCurrent = camera.GetPose();
+        viewCamera.SetPose(MixPoses(cameraPrevious, cameraCurrent, alpha));
+        viewCamera.Zoom = camera.Zoom;
+        viewCamera.SetPerspective(camera.Aspect, camera.NearPlane, camera.FarPlane);
+
+        // nothing visible changed: keep the last image and wait; a held key, the running fan or
+        // a camera still catching up with its last step wakes us for the next simulation step,
+        // otherwise only a new event does
+        bool changed = viewCamera.GetVersion() != renderedCameraVersion || animationTime != renderedSceneTime;
+        bool animating = fanOn || input.anyKeyDown() || cameraPrevious != cameraCurrent;
+#ifdef ROOM_SHADER_HOT_RELOAD
+        animating = animating || shaderReloader.busy();
+#endif
+#ifdef ROOM_GPU_PICKING
+        // keep looking for the answer without waiting for the next event
+        animating = animating || objectIdPass.pending();
+#endif
+        if (!framePacer.beginFrame(changed))
+        {
+            framePacer.waitEvents(animating, simulationClock.untilNextStep());
+            continue;
+        }
+        renderedCameraVersion = viewCamera.GetVersion();
 
         // render
         // ------
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glState.clearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-        // activate shader
-        ourShader.use();
-
         // pass projection matrix to shader (note that in this case it could change every frame)
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        const glm::mat4& projection = viewCamera.GetProjectionMatrix();
         //glm::mat4 projection = glm::ortho(-2.0f, +2.0f, -1.5f, +1.5f, 0.1f, 100.0f);
-        ourShader.setMat4("projection", projection);
 
         // camera/view transformation
-        glm::mat4 view = camera.GetViewMatrix();
+        const glm::mat4& view = viewCamera.GetViewMatrix();
         //glm::mat4 view = basic_camera.createViewMatrix();
-        ourShader.setMat4("view", view);
-
-        glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-        glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-        
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, -0.3f));
-        drawBookself(VAO, ourShader, translateMatrix);
 
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 0.4f));
-        drawTable(VAO, ourShader, translateMatrix);
-
-
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(2.0f, 0.0f, 2.2f));
-        scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.8f, 1.0f, 0.7f));
-        drawTable(VAO, ourShader, translateMatrix * scaleMatrix);
-
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(2.0f, 0.0f, 2.0f));
-        drawCup(VAO, ourShader, translateMatrix);
-
-        //drawCup(VAO, ourShader, identityMatrix);
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 0.3f));
-        drawCup(VAO, ourShader, translateMatrix);
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 0.5f));
-        drawCup(VAO, ourShader, translateMatrix);
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 0.7f));
-        drawCup(VAO, ourShader, translateMatrix);
-
-        drawSofa(VAO, ourShader);
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 0.0f, 1.5f));
-        drawChair(VAO, ourShader, translateMatrix);
-
-        translateMatrix = glm::translate(identityMatrix, glm::vec3(1.5f, 0.0f,-0.3f));
-        rotateYMatrix = glm::rotate(identityMatrix, glm::radians(12.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.5f, 1.3f, 1.2f));
-        drawTelevision(VAO, ourShader, rotateYMatrix*scaleMatrix*translateMatrix);
+        // stream both matrices into this frame's region of the ring buffer (std140: view, projection)
+        frameStream.beginFrame();
+        StreamAllocation frameData = frameStream.allocate(2 * sizeof(glm::mat4));
+        frameStream.write(frameData, 0, &view[0][0], sizeof(glm::mat4));
+        frameStream.write(frameData, sizeof(glm::mat4), &projection[0][0], sizeof(glm::mat4));
+        frameStream.commit();
+        // a full region keeps last frame's binding rather than pointing the block at nothing
+        if (frameData.status != STREAM_FULL)
+            glState.bindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameStream.ID, frameData.offset, frameData.size);
+
+        // only the animated subtrees are dirty while the fan moves; everything else keeps last frame's world matrix
+        if (animationTime != renderedSceneTime) {
+            roomScene.animate(roomInstance, animationTime, roomTransforms);
+            renderedSceneTime = animationTime;
+        }
+        roomTransforms.update();
 
-        if (fanOn) {
-            rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r), glm::vec3(0.0f, 1.0f, 0.0f));
-            drawFan(VAO, ourShader, rotateYMatrix, r);
-            /*rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r+90), glm::vec3(0.0f, 1.0f, 0.0f));
-            drawFan(VAO, ourShader, rotateYMatrix);*/
-            r += 2.0;
+        // each prototype names the cheapest variant it needs: lit furniture, unlit walls/floor/window
+        drawQueue.begin(view, viewCamera.NearPlane, viewCamera.FarPlane);
+#if defined(ROOM_REPORT_OCCLUSION) && defined(ROOM_OCCLUSION_CULLING)
+        double recordStart = glfwGetTime();
+#endif
+        drawQueue.setFrustum(viewCamera.GetFrustumPlanes());
+        const PortalVisibility* visibleCells = nullptr;
+#ifdef ROOM_PORTAL_CULLING
+        if (portalCulling)
+        {
+            portalVisibility.update(viewCamera.Position, viewCamera.GetFrustumPlanes());
+            visibleCells = &portalVisibility;
         }
-        else {
-            drawFan(VAO, ourShader, identityMatrix, r);
+#endif
+#ifdef ROOM_OCCLUSION_CULLING
+        if (occlusionCulling)
+        {
+            occlusionCuller.begin(viewCamera.GetViewProjectionMatrix(), viewCamera.GetFrustumPlanes());
+            roomScene.recordOccluders(roomInstance, roomTransforms, occlusionCuller, visibleCells);
+            occlusionCuller.rasterize();
+            drawQueue.setOcclusion(&occlusionCuller);
         }
+#endif
+        roomScene.record(roomInstance, roomTransforms, drawQueue, roomShaders, VAO, visibleCells);
 
-
-
-        drawOuterWall(VAO, ourShader);
-        drawFloor(VAO, ourShader, identityMatrix);
-        drawWindow(VAO, ourShader);
-        drawFrame(VAO, ourShader,identityMatrix);
+#ifdef ROOM_REPORT_DRAW_ORDER
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        drawOrderStats.begin(drawQueue.Sorted ? 1 : 0);
+#endif
+#ifdef ROOM_INDIRECT_DRAWS
+        indirectDrawer.flush(drawQueue);
+#else
+        drawQueue.flush();
+#endif
+#ifdef ROOM_REPORT_DRAW_COUNTS
+        countedFrames++;
+        countedDraws += drawQueue.Draws;
+        countedCopies += drawQueue.Instances;
+        countedVertices += drawQueue.Vertices;
+#endif
+#ifdef ROOM_REPORT_DRAW_ORDER
+        drawOrderStats.end((unsigned long long)framebufferWidth * framebufferHeight);
+#endif
+#if defined(ROOM_REPORT_OCCLUSION) && defined(ROOM_OCCLUSION_CULLING)
+        occlusionFrameSeconds[occlusionCulling ? 1 : 0] += glfwGetTime() - recordStart;
+        occlusionFrames[occlusionCulling ? 1 : 0]++;
+#endif
         
         
 
@@ -402,10 +740,39 @@ int main()
         //    glDrawArrays(GL_TRIANGLES, 0, 36);
         //}
 
+#ifdef ROOM_GPU_PICKING
+        // ids under the last click, drawn with this frame's matrices and camera block
+        if (idPickPending)
+        {
+            glm::ivec2 framebufferSize;
+            glfwGetFramebufferSize(window, &framebufferSize.x, &framebufferSize.y);
+            if (objectIdPass.begin(viewCamera.GetViewProjectionMatrix(), idPixel, framebufferSize, frameNumber))
+            {
+                glState.bindVertexArray(VAO);
+                roomScene.drawIds(roomInstance, roomTransforms, objectIdPass);
+                objectIdPass.end();
+            }
+            idPickPending = false;
+        }
+#endif
+
+        // everything reading this frame's stream region has been issued
+        frameStream.endFrame();
+
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        input.notePresented(glfwGetTime());
+#ifdef ROOM_GPU_PICKING
+        frameNumber++;
+#endif
+        framePacer.waitEvents(animating, simulationClock.untilNextStep());
+
+#ifdef ROOM_COUNT_ALLOCATIONS
+        allocCheck.endFrame(glfwGetTime());
+        if (allocCheck.finished())
+            glfwSetWindowShouldClose(window, true);
+#endif
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
@@ -413,1075 +780,71 @@ int main()
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    frameStream.release();
+#ifdef ROOM_INDIRECT_DRAWS
+    indirectDrawer.release();
+#endif
+#ifdef ROOM_REPORT_DRAW_ORDER
+    drawOrderStats.release();
+#endif
+#ifdef ROOM_GPU_PICKING
+    objectIdPass.release();
+#endif
+#ifdef ROOM_SHADER_HOT_RELOAD
+    shaderReloader.stop();
+#endif
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
+#ifdef ROOM_REPORT_INPUT_LATENCY
+    input.report();
+#endif
+#ifdef ROOM_REPORT_FRAME_PACING
+    framePacer.report();
+#endif
+#ifdef ROOM_REPORT_SHADER_VARIANTS
+    roomShaders.report();
+#endif
+#ifdef ROOM_REPORT_GL_STATE
+    glState.report();
+#endif
+#ifdef ROOM_REPORT_DRAW_ORDER
+    const char* const drawOrderNames[GpuFrameStats::MODES] = { "recording order", "sorted" };
+    drawOrderStats.report(drawOrderNames);
+    std::cout << "last frame: " << drawQueue.Draws << " draws, " << drawQueue.ProgramChanges << " program changes, "
+        << drawQueue.MaterialChanges << " color changes, sorted in " << 1.0e6 * drawQueue.SortSeconds << " us" << std::endl;
+#endif
+#if defined(ROOM_REPORT_DRAW_ORDER) && defined(ROOM_INDIRECT_DRAWS)
+    indirectDrawer.report();
+#endif
+#if defined(ROOM_REPORT_OCCLUSION) && defined(ROOM_OCCLUSION_CULLING)
+    occlusionCuller.report();
+    for (int i = 0; i < 2; i++)
+        if (occlusionFrames[i])
+            std::cout << "  " << (i ? "with" : "without") << " occlusion culling: " << 1000.0 * occlusionFrameSeconds[i] / occlusionFrames[i]
+                << " ms from recording to submission over " << occlusionFrames[i] << " frames" << std::endl;
+#endif
+#if defined(ROOM_REPORT_PORTALS) && defined(ROOM_PORTAL_CULLING)
+    portalVisibility.report();
+#endif
+#if defined(ROOM_REPORT_COLLISION) && defined(ROOM_CAMERA_COLLISION)
+    cameraCollider.report();
+#endif
+#ifdef ROOM_GPU_PICKING
+    objectIdPass.report();
+#endif
+#ifdef ROOM_REPORT_DRAW_COUNTS
+    if (countedFrames)
+        std::cout << "draw counts over " << countedFrames << " frames: " << (double)countedDraws / countedFrames << " draws of "
+            << (double)countedCopies / countedFrames << " copies, " << (double)countedVertices / countedFrames << " vertices per frame" << std::endl;
+#endif
+#ifdef ROOM_COUNT_ALLOCATIONS
+    allocCheck.report();
+    return allocCheck.passed() ? 0 : -1;
+#else
     return 0;
-}
-void drawBookself(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 0.4f));
-    model = matr * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.145f, 0.271f, 0.078f, 1.0f));
-    //ourShader.setVec4("color", glm::vec4(0.067f, 0.388f, 0.098f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.071f, 0.098f, 0.173f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.2f, 2.5f, 0.4f));
-    model = matr * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.102f, 0.188f, 0.051f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.9f, 0.0f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.2f, 2.5f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.173f, 0.278f, 0.11f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 1.15f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.1f, 0.8325f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.6f, 0.1f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.192f, 0.459f, 0.22f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.1f, 0.515f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.6f, 0.1f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.192f, 0.459f, 0.22f, 1.0f));
-    //ourShader.setVec4("color", glm::vec4(0.196f, 0.361f, 0.11f, 1.0f));
-    //ourShader.setVec4("color", glm::vec4(0.122f, 0.165f, 0.29f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.192f, 0.459f, 0.22f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.45f, 0.1f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.2f, 0.83f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.122f, 0.165f, 0.29f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //for book
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.15f, 0.1f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.60f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.071f, 0.18f, 0.024f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.22f, 0.1f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.60f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.196f, 0.043f, 0.439f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.29f, 0.1f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.60f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.496f, 0.73f, 0.439f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.36f, 0.1f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.60f, 0.4f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.612f, 0.404f, 0.098f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(9.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.28f, 0.835f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.50f, 0.4f));
-    model = matr * rotateZMatrix * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.776f, 0.859f, 0.027f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(9.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.36f, 0.830f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.50f, 0.4f));
-    model = matr * rotateZMatrix * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.58f, 0.102f, 0.184f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(9.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.44f, 0.825f, 0.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.50f, 0.4f));
-    model = matr * rotateZMatrix * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.58f, 0.102f, 0.184f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-}
-
-void drawTable(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, 0.15f, 1.5f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.404f, 0.337f, 0.298f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //draw leg of table
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.251f, 0.227f, 0.216f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.825f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.251f, 0.227f, 0.216f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.825f, 0.4f, 1.475f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.251f, 0.227f, 0.216f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 1.475f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.251f, 0.227f, 0.216f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-   
-}
-
-void drawChair(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, 0.15f, 1.0f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.404f, 0.337f, 0.298f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.549f, 0.255f, 0.11f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 1.28f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, 1.5f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.404f, 0.337f, 0.298f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.682f, 0.333f, 0.153f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //draw leg of chair
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.825f, 0.4f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.825f, 0.4f, 1.28f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 1.28f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    //handle of cahir
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.40f, 0.8f, 2.40f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.65f, 0.1f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.45f, 0.8f, 2.45f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(-0.1f, -0.1f, 0.70f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.85f, 0.8f, 2.40f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.65f, 0.1f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.90f, 0.8f, 2.45f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(-0.1f, -0.1f, 0.70f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-}
-
-void drawFrame(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-   
-
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(0.85f, 2.5f, 3.4f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.60f, -0.65f, 0.6f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.90f, 0.8f, 2.45f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(-0.1f, -0.1f, 0.70f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);*/
-
-}
-
-void drawCup(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-
-    //draw cup on table
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.5f, 0.47f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.03f, 0.3f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.447f, 0.451f, 0.443f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.131f, 1.0f));
-    
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.5f, 0.47f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, 0.3f, 0.03f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.831f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.831f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.5f, 0.47f, 1.07f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, 0.3f, 0.03f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.831f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.831f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.56f, 0.47f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.03f, 0.3f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //ourShader.setVec4("color", glm::vec4(0.447f, 0.451f, 0.443f, 1.0f));
-    ourShader.setVec4("color", glm::vec4(0.863f, 0.871f, 0.831f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //handle of cup
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.535f, 0.5f, 1.07f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.02f, 0.02f, 0.14f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.149f, 0.149f, 0.145f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.535f, 0.5f, 1.13f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.02f, 0.14f, 0.02f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.535f, 0.57f, 1.07f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.02f, 0.02f, 0.14f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-}
-
-
-void drawSofa(unsigned int VAO, Shader ourShader) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.5f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.15f, 0.15f, 3.0f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.549f, 0.255f, 0.11f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.5f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.005f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.005f, 0.3f, 1.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.5f, 0.3f, 1.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.5f, 0.3f, 2.225f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.005f, 0.3f, 2.225f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -0.75f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //backwall of sofa
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.5f, 0.35f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, 1.0f, 3.0f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.682f, 0.333f, 0.153f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //side handle of sofa
-
-    //left hand
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.1f, 0.7f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.75f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.1f, 0.7f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(-0.750f, -0.1f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    //right hand
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.1f, 0.7f, 2.225f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.75f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-0.1f, 0.7f, 2.225f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(-0.750f, -0.1f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-}
-
-void drawTelevision(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    //cells
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.5f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, 0.15f, 1.0f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.373f, 0.412f, 0.216f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //cells
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.5f, 0.10f, 0.87f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, 0.15f, 0.7f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.247f, 0.271f, 0.137f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.925f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 1.0f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.157f, 0.075f, 0.035f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.5f, 0.3f, 0.8f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.5f, 0.3f, 1.225f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.0f, -1.0f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 0.4f, 1.225f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.15f, -1.0f, 0.15f));
-    //model = translateMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //television drawing.....
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.65f, 0.4f, 0.95f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.3f, 0.10f, 0.5f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.071f, 0.071f, 0.067f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.4f, 1.05f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, 0.30f, 0.15f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.118f, 0.122f, 0.114f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    // pc frame...............
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.5f, 0.74f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, 0.10f, 1.5f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.071f, 0.071f, 0.067f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.5f, 0.74f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, 0.75f, 0.10f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.85f, 0.74f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, 0.10f, 1.5f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.5f, 1.44f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, 0.75f, 0.10f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //pc screen............
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(1.77f, 0.86f, 0.80f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.60f, 1.3f));
-    model = matr * translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.784f, 0.812f, 0.678f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-
-}
-
-void drawFan(unsigned int VAO, Shader ourShader, glm::mat4 matr, float r) {
-    // Modelling Transformation
-    glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model,combined, translateMatrix3;
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(scale_X, scale_Y, scale_Z));
-    model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;*/
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(translate_X, translate_Y, translate_Z));
-    //rotateXMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_X), glm::vec3(1.0f, 0.0f, 0.0f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Y), glm::vec3(0.0f, 1.0f, 0.0f));
-    //rotateZMatrix = glm::rotate(identityMatrix, glm::radians(rotateAngle_Z), glm::vec3(0.0f, 0.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.2f, 2.0f));
-    //model = translateMatrix * rotateXMatrix * rotateYMatrix * rotateZMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 3.0f, 0.8f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.6f, 0.10f, 0.2f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r), glm::vec3(0.0f, 1.0f, 0.0f));
-    //model = translateMatrix * matr * glm::translate(identityMatrix, glm::vec3(-0.4f, -3.0f, -0.8f)) * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(0.4f, 3.0f, 0.8f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(1.6f, 0.10f, 0.2f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r+90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    //model = translateMatrix * matr * glm::translate(identityMatrix, glm::vec3(-0.4f, -3.0f, -0.8f)) * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 2.5f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.1f, 0.2f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = translateMatrix *  glm::translate(identityMatrix, glm::vec3(0.5f, 0.0f, 0.0f)) * rotateYMatrix * glm::translate(identityMatrix, glm::vec3(-0.5f, 0.0f, 0.0f)) * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.071f, 0.071f, 0.067f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 2.5f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.1f, 0.2f));
-    rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r + 90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    model = translateMatrix * glm::translate(identityMatrix, glm::vec3(0.5f, 0.0f, 0.0f)) * rotateYMatrix * glm::translate(identityMatrix, glm::vec3(-0.5f, 0.0f, 0.0f)) * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(0.465f, 2.54f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.1f, 0.88f, 0.1f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.259f, 0.259f, 0.251f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(0.0f, 3.0f, 1.0f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(2.0f, 0.1f, 0.2f));
-    //rotateYMatrix = glm::rotate(identityMatrix, glm::radians(r + 120.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    //model = translateMatrix * glm::translate(identityMatrix, glm::vec3(0.5f, 0.0f, 0.0f)) * rotateYMatrix * glm::translate(identityMatrix, glm::vec3(-0.5f, 0.0f, 0.0f)) * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-}
-
-
-void drawOuterWall(unsigned int VAO, Shader ourShader) {
-
-    glm::mat4 identityMatrix = glm::mat4(1.0f);
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-1.0f, -0.01f, -0.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(8.5f, 6.0f, 8.0f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.82f, 0.702f, 0.667f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0);
-
-
-    /*translateMatrix = glm::translate(identityMatrix, glm::vec3(-1.0f, 0.01f, -0.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.0f, 6.0f, 3.5f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(1.0f, 0.8431f, 0.7019f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 18, GL_UNSIGNED_INT, 0);*/
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-1.0f, 2.98f, -0.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(8.5f, 0.01f, 8.0f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.871f, 0.851f, 0.82f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(-1.0f, -0.3f, -0.5f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(8.5f, 0.5f, 8.0f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    ourShader.setVec4("color", glm::vec4(0.82f, 0.698f, 0.576f, 1.0f));
-    //ourShader.setVec4("color", glm::vec4(0.894f, 0.902f, 0.906f, 1.0f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-}
-
-void drawFloor(unsigned int VAO, Shader ourShader, glm::mat4 matr) {
-    glm::mat4 identityMatrix = glm::mat4(1.0f);
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-
-    //translateMatrix = glm::translate(identityMatrix, glm::vec3(-1.0f, -0.02f, -0.5f));
-    //scaleMatrix = glm::scale(identityMatrix, glm::vec3(8.5f, 0.01f, 8.0f));
-    //model = translateMatrix * scaleMatrix;
-    //ourShader.setMat4("model", model);
-    ////ourShader.setVec4("color", glm::vec4(0.82f, 0.698f, 0.576f, 1.0f));
-    //ourShader.setVec4("color", glm::vec4(0.894f, 0.902f, 0.906f, 1.0f));
-   
-    //glBindVertexArray(VAO);
-    //glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    for (int i = 0; i <= 16; i++) {
-        if (i % 2 == 0) {
-            for (int j = 0; j < 16; j++) {
-                translateMatrix = glm::translate(identityMatrix, glm::vec3(( - 1.0+0.25*i), -0.02f, (-0.5 + 0.25 * j)));
-                scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.5f, 0.01f, 0.5f));
-                model = translateMatrix * scaleMatrix;
-                ourShader.setMat4("model", model);
-                if (j % 2 == 0)
-                    //ourShader.setVec4("color", glm::vec4(0.82f, 0.698f, 0.576f, 1.0f));
-                    ourShader.setVec4("color", glm::vec4(0.839f, 0.725f, 0.725f, 1.0f));
-                else {
-                    //ourShader.setVec4("color", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-                    ourShader.setVec4("color", glm::vec4(0.439f, 0.384f, 0.384f, 1.0f));
-                }
-                //ourShader.setVec4("color", glm::vec4(0.894f, 0.902f, 0.906f, 1.0f));
-
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-            }
-        }
-        else {
-
-            for (int j = 0; j < 16; j++) {
-                translateMatrix = glm::translate(identityMatrix, glm::vec3((-1.0 + 0.25 * i), -0.02f, (-0.5 + 0.25 * j)));
-                scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.5f, 0.01f, 0.5f));
-                model = translateMatrix * scaleMatrix;
-                ourShader.setMat4("model", model);
-                if (j % 2 != 0)
-                    //ourShader.setVec4("color", glm::vec4(0.82f, 0.698f, 0.576f, 1.0f));
-                    ourShader.setVec4("color", glm::vec4(0.839f, 0.725f, 0.725f, 1.0f));
-                else {
-                    //ourShader.setVec4("color", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-                    ourShader.setVec4("color", glm::vec4(0.439f, 0.384f, 0.384f, 1.0f));
-                }
-                //ourShader.setVec4("color", glm::vec4(0.894f, 0.902f, 0.906f, 1.0f));
-
-                glBindVertexArray(VAO);
-                glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-            }
-
-        }
-    }
-
-}
-
-
-
-
-void drawWindow(unsigned int VAO, Shader ourShader) {
-
-    glm::mat4 identityMatrix = glm::mat4(1.0f);
-    glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.2f, 2.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 2.8f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //window frame
-    //left
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.15f, 2.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    ourShader.setVec4("color", glm::vec4(0.239f, 0.239f, 0.067f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    //top
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.15f, 2.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.1f, 2.8f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    //right
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.15f, 2.0f, 2.35f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 0.10f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //bottom
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.15f, 1.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -0.1f, 2.8f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-    //middle divider
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.15f, 2.0f, 1.65f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 0.15f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec3("aColor", glm::vec3(0.2f, 0.1f, 0.4f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //right glass of the window
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.18f, 2.0f, 1.65f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 1.4f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec4("Color", glm::vec4(1.0f, 1.0f, 1.0f,1.0f));
-    ourShader.setVec4("color", glm::vec4(0.941f, 0.949f, 0.886f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-    //left glass of the window
-
-    translateMatrix = glm::translate(identityMatrix, glm::vec3(3.18f, 2.0f, 1.0f));
-    scaleMatrix = glm::scale(identityMatrix, glm::vec3(0.10f, -2.0f, 1.4f));
-    model = translateMatrix * scaleMatrix;
-    ourShader.setMat4("model", model);
-    //ourShader.setVec4("Color", glm::vec4(1.0f, 1.0f, 1.0f,1.0f));
-    ourShader.setVec4("color", glm::vec4(0.941f, 0.949f, 0.886f, 1.0f));
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
+#endif
 }
 
 
@@ -1493,22 +856,33 @@ void drawWindow(unsigned int VAO, Shader ourShader) {
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    glm::vec2 look = input.mouseDelta();
+    if (look.x != 0.0f || look.y != 0.0f)
+        camera.ProcessMouseMovement(look.x, look.y);
+    glm::vec2 wheel = input.scrollDelta();
+    if (wheel.y != 0.0f)
+        camera.ProcessMouseScroll(wheel.y);
+
+    if (input.isDown(GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+#ifdef ROOM_CAMERA_COLLISION
+    glm::vec3 eyeBefore = camera.Position;
+#endif
+
+    if (input.isDown(GLFW_KEY_W)) {
         camera.ProcessKeyboard(FORWARD, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    if (input.isDown(GLFW_KEY_S)) {
         camera.ProcessKeyboard(BACKWARD, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    if (input.isDown(GLFW_KEY_A)) {
         camera.ProcessKeyboard(LEFT, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    if (input.isDown(GLFW_KEY_D)) {
         camera.ProcessKeyboard(RIGHT, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_E))
     {
         /*eyeY -= 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);*/
@@ -1516,7 +890,7 @@ void processInput(GLFWwindow* window)
 
     }
 
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_R))
     {
         /*if (rotateAxis_X) rotateAngle_X -= 1;
         else if (rotateAxis_Y) rotateAngle_Y -= 1;
@@ -1524,24 +898,28 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(DOWN, deltaTime);
     }
 
-    if (glfwGetKey(window, GLFW_KEY_0) == GLFW_PRESS) {
+    if (input.isDown(GLFW_KEY_0)) {
         camera.ProcessKeyboard(WORLD_UP, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) translate_Y += 0.001;
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) translate_Y -= 0.001;
-    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) translate_X += 0.001;
-    if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS) translate_X -= 0.001;
-    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) translate_Z += 0.001;
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) translate_Z -= 0.001;
+#ifdef ROOM_CAMERA_COLLISION
+    if (camera.Position != eyeBefore)
+        camera.Position = cameraCollider.move(eyeBefore, camera.Position);
+#endif
+    if (input.isDown(GLFW_KEY_I)) translate_Y += 0.001;
+    if (input.isDown(GLFW_KEY_K)) translate_Y -= 0.001;
+    if (input.isDown(GLFW_KEY_L)) translate_X += 0.001;
+    if (input.isDown(GLFW_KEY_J)) translate_X -= 0.001;
+    if (input.isDown(GLFW_KEY_O)) translate_Z += 0.001;
+    if (input.isDown(GLFW_KEY_P)) translate_Z -= 0.001;
     /*if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) scale_X += 0.001;*/
-    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) scale_X -= 0.001;
-    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS) scale_Y += 0.001;
-    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) scale_Y -= 0.001;
-    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) scale_Z += 0.001;
-    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) scale_Z -= 0.001;
+    if (input.isDown(GLFW_KEY_V)) scale_X -= 0.001;
+    if (input.isDown(GLFW_KEY_B)) scale_Y += 0.001;
+    if (input.isDown(GLFW_KEY_N)) scale_Y -= 0.001;
+    if (input.isDown(GLFW_KEY_M)) scale_Z += 0.001;
+    if (input.isDown(GLFW_KEY_U)) scale_Z -= 0.001;
 
     //pitch operation......
-    if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_X))
     {
         /*rotateAngle_X += 0.05;
         rotateAxis_X = 0.05;
@@ -1550,12 +928,12 @@ void processInput(GLFWwindow* window)
 
         camera.ProcessKeyboard(PITCH_A, deltaTime);
     }
-    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+    if (input.isDown(GLFW_KEY_C)) {
         camera.ProcessKeyboard(PITCH_C, deltaTime);
     }
 
     //YAW operation.........
-    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_Y))
     {
         /*rotateAngle_Y += 0.05;
         rotateAxis_X = 0.05;
@@ -1564,7 +942,7 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(YAW_R, deltaTime);
 
     }
-    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_T))
     {
         /*eyeZ += 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);*/
@@ -1573,7 +951,7 @@ void processInput(GLFWwindow* window)
     }
 
 
-    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_Z))
     {
         /*rotateAngle_Z += 0.05;
         rotateAxis_X = 0.0;
@@ -1583,18 +961,66 @@ void processInput(GLFWwindow* window)
         
     }
 
-    if (glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_H))
     {
         eyeX += 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_F))
     {
         eyeX -= 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);
     }
     
-    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS)
+    if (input.wasPressed(GLFW_KEY_F2))
+    {
+        drawQueue.Sorted = !drawQueue.Sorted;
+        std::cout << (drawQueue.Sorted ? "draws sorted" : "draws in recording order") << std::endl;
+    }
+#ifdef ROOM_OCCLUSION_CULLING
+    if (input.wasPressed(GLFW_KEY_F3))
+    {
+        occlusionCulling = !occlusionCulling;
+        std::cout << (occlusionCulling ? "occlusion culling on" : "occlusion culling off") << std::endl;
+    }
+#endif
+#ifdef ROOM_PORTAL_CULLING
+    if (input.wasPressed(GLFW_KEY_F4))
+    {
+        portalCulling = !portalCulling;
+        std::cout << (portalCulling ? "portal culling on" : "portal culling off") << std::endl;
+    }
+#endif
+#ifdef ROOM_PICKING
+    if (input.wasClicked(GLFW_MOUSE_BUTTON_LEFT))
+    {
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+        if (width > 0 && height > 0)
+        {
+            pickRay = ObjectPicker::rayThroughPixel(viewCamera.GetInverseViewProjectionMatrix(), input.clickPosition(GLFW_MOUSE_BUTTON_LEFT), glm::vec2((float)width, (float)height));
+            pickPending = true;
+        }
+    }
+#endif
+#ifdef ROOM_GPU_PICKING
+    if (input.wasClicked(GLFW_MOUSE_BUTTON_RIGHT))
+    {
+        // the click is in window coordinates (origin top left), the id pass in framebuffer pixels
+        int windowWidth, windowHeight, framebufferWidth, framebufferHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        if (windowWidth > 0 && windowHeight > 0)
+        {
+            glm::vec2 click = input.clickPosition(GLFW_MOUSE_BUTTON_RIGHT);
+            idPixel = glm::ivec2((int)(click.x * framebufferWidth / windowWidth), framebufferHeight - 1 - (int)(click.y * framebufferHeight / windowHeight));
+            idPickPending = true;
+            framePacer.requestRedraw();
+        }
+    }
+#endif
+    // toggles once per press, holding G no longer flips the fan every frame
+    if (input.wasPressed(GLFW_KEY_G))
     {
         /*eyeZ -= 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);*/
@@ -1607,51 +1033,51 @@ void processInput(GLFWwindow* window)
         }
     }
 
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_Q))
     {
         eyeY += 2.5 * deltaTime;
         basic_camera.changeEye(eyeX, eyeY, eyeZ);
     }
    
-    if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_1))
     {
         lookAtX += 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_2))
     {
         lookAtX -= 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_3))
     {
         lookAtY += 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_4))
     {
         lookAtY -= 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_5) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_5))
     {
         lookAtZ += 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_6) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_6))
     {
         lookAtZ -= 2.5 * deltaTime;
         basic_camera.changeLookAt(lookAtX, lookAtY, lookAtZ);
     }
-    if (glfwGetKey(window, GLFW_KEY_7) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_7))
     {
         basic_camera.changeViewUpVector(glm::vec3(1.0f, 0.0f, 0.0f));
     }
-    if (glfwGetKey(window, GLFW_KEY_8) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_8))
     {
         basic_camera.changeViewUpVector(glm::vec3(0.0f, 1.0f, 0.0f));
     }
-    if (glfwGetKey(window, GLFW_KEY_9) == GLFW_PRESS)
+    if (input.isDown(GLFW_KEY_9))
     {
         basic_camera.changeViewUpVector(glm::vec3(0.0f, 0.0f, 1.0f));
     }
@@ -1663,42 +1089,30 @@ void processInput(GLFWwindow* window)
 
 }
 
+// advance everything that animates by one simulation step of dt seconds
+void updateSimulation(float dt)
+{
+    sceneTimePrevious = sceneTime;
+    if (fanOn)
+        sceneTime += dt;
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    glState.viewport(0, 0, width, height);
+    // minimizing reports a 0x0 framebuffer, keep the last aspect then
+    if (width > 0 && height > 0)
+        camera.SetAspect((float)width / (float)height);
+    framePacer.requestRedraw();
 }
 
-
-// glfw: whenever the mouse moves, this callback is called
-// -------------------------------------------------------
-void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
+// glfw: the window contents were damaged (uncovered, restored ...) and have to be drawn again
+// -------------------------------------------------------------------------------------------
+void window_refresh_callback(GLFWwindow* /*window*/)
 {
-    float xpos = static_cast<float>(xposIn);
-    float ypos = static_cast<float>(yposIn);
-
-    if (firstMouse)
-    {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-    lastX = xpos;
-    lastY = ypos;
-
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    framePacer.requestRedraw();
 }
-
-// glfw: whenever the mouse scroll wheel scrolls, this callback is called
-// ----------------------------------------------------------------------
-void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
-{
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
-}
\ No newline at end of file
@@ -0,0 +1,381 @@
+#pragma once
+
+//
+//  mesh_library.h
+//  3D Object Drawing
+//
+
+#ifndef MESH_LIBRARY_H
+#define MESH_LIBRARY_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// a mesh of the library: indices [firstIndex, firstIndex + indexCount) of the shared index
+// buffer, pointing at vertices [firstVertex, firstVertex + vertexCount)
+struct MeshRange
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    glm::vec3 boxMin;
+    glm::vec3 boxMax;
+};
+
+// Indexed meshes in one vertex and one index buffer (a mesh atlas), so everything draws from
+// the same vertex array and a mesh is only a range of the indices. Vertices are the layout of
+// the cube: position, then color (STRIDE floats); indices point at vertices of the whole
+// atlas, so a range draws with glDrawElements as it is and no base vertex.
+//
+// add() copies a mesh that exists already (the cube goes first, so scene parts indexing it
+// keep their ranges). Generated meshes are built between begin() and end() from primitives,
+// each placed by a transform and painted in the current setColor():
+//  - cylinder, sphere, torus (or an arc of one), rounded box, extrusion of a convex outline
+//  - before its transform every primitive lies in the cube's box [0, BOX] (a torus flat in
+//    its middle, the others filling it), so one standing in for a cube part takes that
+//    part's transform unchanged
+// Tessellation (segments, rings) is given per primitive. Draws are culled against the cube's
+// box (DrawQueue::LocalMin/LocalMax), so end() complains about a mesh that leaves it.
+class MeshLibrary
+{
+public:
+    enum { NONE = 0xFFFFFFFFu, STRIDE = 6 };
+    // side of the box every mesh fits in: the cube's
+    static constexpr float BOX = 0.5f;
+
+    MeshLibrary() : color(1.0f), building(NONE)
+    {
+    }
+
+    // a finished mesh: vertexCount vertices of stride floats (position and color first) and
+    // indices into them; returns its id
+    uint32_t add(const char* meshName, const float* meshVertices, size_t vertexCount, size_t stride, const unsigned int* meshIndices, size_t indexCount)
+    {
+        begin(meshName);
+        uint32_t base = vertexCount32();
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            const float* v = meshVertices + i * stride;
+            for (size_t k = 0; k < STRIDE; k++)
+                vertices.push_back(v[k]);
+        }
+        for (size_t i = 0; i < indexCount; i++)
+            indices.push_back(base + meshIndices[i]);
+        return end();
+    }
+
+    // start a generated mesh; the primitives added until end() make it up
+    void begin(const char* meshName)
+    {
+        MeshRange mesh = { (uint32_t)indices.size(), 0, vertexCount32(), 0, glm::vec3(0.0f), glm::vec3(0.0f) };
+        meshes.push_back(mesh);
+        names.push_back(meshName);
+        building = (uint32_t)meshes.size() - 1;
+    }
+
+    // finish the mesh begin() started; returns its id
+    uint32_t end()
+    {
+        MeshRange& mesh = meshes[building];
+        mesh.indexCount = (uint32_t)indices.size() - mesh.firstIndex;
+        mesh.vertexCount = vertexCount32() - mesh.firstVertex;
+        mesh.boxMin = glm::vec3(1e30f);
+        mesh.boxMax = glm::vec3(-1e30f);
+        for (uint32_t i = mesh.firstVertex; i < mesh.firstVertex + mesh.vertexCount; i++)
+        {
+            glm::vec3 p(vertices[i * STRIDE], vertices[i * STRIDE + 1], vertices[i * STRIDE + 2]);
+            mesh.boxMin = glm::min(mesh.boxMin, p);
+            mesh.boxMax = glm::max(mesh.boxMax, p);
+        }
+        const float slack = 1e-4f;
+        if (mesh.boxMin.x < -slack || mesh.boxMin.y < -slack || mesh.boxMin.z < -slack
+            || mesh.boxMax.x > BOX + slack || mesh.boxMax.y > BOX + slack || mesh.boxMax.z > BOX + slack)
+            std::cout << "ERROR::MESH_LIBRARY::OUTSIDE_CUBE_BOX: " << names[building] << " would be culled wrongly" << std::endl;
+        uint32_t id = building;
+        building = NONE;
+        return id;
+    }
+
+    // color of the vertices added from now on
+    void setColor(const glm::vec3& value)
+    {
+        color = value;
+    }
+
+    // along y, the full height of the box; caps close the ends
+    void addCylinder(const glm::mat4& transform, unsigned int segments, bool bottomCap = true, bool topCap = true)
+    {
+        segments = segments < 3 ? 3 : segments;
+        const float r = 0.5f * BOX;
+        uint32_t first = vertexCount32();
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float angle = TWO_PI * s / segments;
+            glm::vec3 rim(r + r * std::cos(angle), 0.0f, r + r * std::sin(angle));
+            vertex(transform, rim);
+            vertex(transform, rim + glm::vec3(0.0f, BOX, 0.0f));
+        }
+        for (unsigned int s = 0; s < segments; s++)
+            quad(first + 2 * s, first + 2 * s + 2, first + 2 * s + 3, first + 2 * s + 1);
+        if (bottomCap)
+            disk(transform, segments, 0.0f, true);
+        if (topCap)
+            disk(transform, segments, BOX, false);
+    }
+
+    // rings from pole to pole, segments around y
+    void addSphere(const glm::mat4& transform, unsigned int rings, unsigned int segments)
+    {
+        rings = rings < 2 ? 2 : rings;
+        segments = segments < 3 ? 3 : segments;
+        const float r = 0.5f * BOX;
+        uint32_t first = vertexCount32();
+        for (unsigned int i = 0; i <= rings; i++)
+        {
+            float polar = PI * i / rings;
+            for (unsigned int s = 0; s <= segments; s++)
+            {
+                float angle = TWO_PI * s / segments;
+                glm::vec3 n(std::sin(polar) * std::cos(angle), -std::cos(polar), std::sin(polar) * std::sin(angle));
+                vertex(transform, glm::vec3(r) + r * n);
+            }
+        }
+        grid(first, rings, segments);
+    }
+
+    // around y in the middle of the box; tube is the tube's radius over the outer radius (up to
+    // 0.5), degrees less than 360 leave an open arc starting at +x and turning towards +z
+    void addTorus(const glm::mat4& transform, unsigned int segments, unsigned int tubeSegments, float tube, float degrees = 360.0f)
+    {
+        segments = segments < 3 ? 3 : segments;
+        tubeSegments = tubeSegments < 3 ? 3 : tubeSegments;
+        tube = tube < 0.01f ? 0.01f : (tube > 0.5f ? 0.5f : tube);
+        const float outer = 0.5f * BOX;
+        const float minor = tube * outer;
+        const float major = outer - minor;
+        const float arc = TWO_PI * (degrees > 360.0f ? 360.0f : degrees) / 360.0f;
+        uint32_t first = vertexCount32();
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float angle = arc * s / segments;
+            glm::vec3 direction(std::cos(angle), 0.0f, std::sin(angle));
+            for (unsigned int t = 0; t <= tubeSegments; t++)
+            {
+                float around = TWO_PI * t / tubeSegments;
+                glm::vec3 p = direction * (major + minor * std::cos(around)) + glm::vec3(0.0f, minor * std::sin(around), 0.0f);
+                vertex(transform, glm::vec3(outer) + p);
+            }
+        }
+        grid(first, segments, tubeSegments);
+    }
+
+    // the box with its edges and corners rounded to radius (up to half the box), segments per
+    // quarter circle
+    void addRoundedBox(const glm::mat4& transform, float radius, unsigned int segments)
+    {
+        segments = segments < 1 ? 1 : segments;
+        const float half = 0.5f * BOX;
+        radius = radius < 0.0f ? 0.0f : (radius > half ? half : radius);
+        const float inset = half - radius;
+        // a sphere of radius cut into octants pushed out to the corners; rows and columns are
+        // doubled where the octants meet, and the quads between the copies are the flat faces
+        const unsigned int rows = 2 * (segments + 1), columns = 4 * (segments + 1);
+        uint32_t first = vertexCount32();
+        for (unsigned int i = 0; i < rows; i++)
+        {
+            unsigned int row = i % (segments + 1);
+            float polar = HALF_PI * (i < segments + 1 ? (float)row / segments : 1.0f + (float)row / segments);
+            float up = i < segments + 1 ? -1.0f : 1.0f;
+            for (unsigned int c = 0; c < columns; c++)
+            {
+                unsigned int quarter = c / (segments + 1);
+                float angle = HALF_PI * (quarter + (float)(c % (segments + 1)) / segments);
+                glm::vec3 n(std::sin(polar) * std::cos(angle), -std::cos(polar), std::sin(polar) * std::sin(angle));
+                glm::vec3 corner(quarter == 0 || quarter == 3 ? inset : -inset, up * inset, quarter < 2 ? inset : -inset);
+                vertex(transform, glm::vec3(half) + corner + radius * n);
+            }
+        }
+        // rows wrap around: the last column meets the first
+        for (unsigned int i = 0; i + 1 < rows; i++)
+            for (unsigned int c = 0; c < columns; c++)
+            {
+                uint32_t a = first + i * columns + c, b = first + i * columns + (c + 1) % columns;
+                quad(a, b, b + columns, a + columns);
+            }
+        // the pole rows are the corners of the bottom and top faces
+        uint32_t bottom = first, top = first + (rows - 1) * columns;
+        for (int k = 0; k < 2; k++)
+        {
+            uint32_t row = k == 0 ? bottom : top;
+            uint32_t c0 = row, c1 = row + (segments + 1), c2 = row + 2 * (segments + 1), c3 = row + 3 * (segments + 1);
+            if (k == 0)
+                quad(c0, c3, c2, c1);
+            else
+                quad(c0, c1, c2, c3);
+        }
+    }
+
+    // a convex outline in x and z (inside [0, BOX]), counterclockwise seen from above, swept
+    // over the height of the box; caps close both ends
+    void addExtrusion(const glm::mat4& transform, const glm::vec2* outline, size_t count, bool caps = true)
+    {
+        if (count < 3)
+            return;
+        // each side gets its own four corners so it stays flat under lighting and vertex colors
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::vec2& a = outline[i];
+            const glm::vec2& b = outline[(i + 1) % count];
+            uint32_t first = vertexCount32();
+            vertex(transform, glm::vec3(a.x, 0.0f, a.y));
+            vertex(transform, glm::vec3(b.x, 0.0f, b.y));
+            vertex(transform, glm::vec3(b.x, BOX, b.y));
+            vertex(transform, glm::vec3(a.x, BOX, a.y));
+            quad(first, first + 1, first + 2, first + 3);
+        }
+        if (!caps)
+            return;
+        for (int k = 0; k < 2; k++)
+        {
+            uint32_t first = vertexCount32();
+            for (size_t i = 0; i < count; i++)
+                vertex(transform, glm::vec3(outline[i].x, k ? BOX : 0.0f, outline[i].y));
+            for (uint32_t i = 1; i + 1 < count; i++)
+            {
+                if (k)
+                    triangle(first, first + i + 1, first + i);
+                else
+                    triangle(first, first + i, first + i + 1);
+            }
+        }
+    }
+
+    uint32_t find(const char* meshName) const
+    {
+        for (size_t i = 0; i < names.size(); i++)
+            if (names[i] == meshName)
+                return (uint32_t)i;
+        return NONE;
+    }
+
+    size_t meshCount() const
+    {
+        return meshes.size();
+    }
+
+    const MeshRange& mesh(uint32_t id) const
+    {
+        return meshes[id];
+    }
+
+    const char* name(uint32_t id) const
+    {
+        return names[id].c_str();
+    }
+
+    // the atlas, for the vertex and index buffers
+    const float* vertexData() const
+    {
+        return vertices.data();
+    }
+
+    size_t vertexCount() const
+    {
+        return vertices.size() / STRIDE;
+    }
+
+    const unsigned int* indexData() const
+    {
+        return indices.data();
+    }
+
+    size_t indexCount() const
+    {
+        return indices.size();
+    }
+
+    void report() const
+    {
+        std::cout << "mesh library: " << meshes.size() << " meshes, " << vertexCount() << " vertices, " << indices.size() << " indices, "
+            << (vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int)) / 1024.0 << " KB" << std::endl;
+        for (size_t i = 0; i < meshes.size(); i++)
+            std::cout << "  " << names[i] << ": " << meshes[i].vertexCount << " vertices, " << meshes[i].indexCount / 3 << " triangles" << std::endl;
+    }
+
+private:
+    static constexpr float PI = 3.14159265358979f;
+    static constexpr float TWO_PI = 2.0f * PI;
+    static constexpr float HALF_PI = 0.5f * PI;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<MeshRange> meshes;
+    std::vector<std::string> names;
+    glm::vec3 color;
+    uint32_t building;
+
+    uint32_t vertexCount32() const
+    {
+        return (uint32_t)(vertices.size() / STRIDE);
+    }
+
+    uint32_t vertex(const glm::mat4& transform, const glm::vec3& position)
+    {
+        glm::vec3 p = glm::vec3(transform * glm::vec4(position, 1.0f));
+        const float v[STRIDE] = { p.x, p.y, p.z, color.x, color.y, color.z };
+        vertices.insert(vertices.end(), v, v + STRIDE);
+        return vertexCount32() - 1;
+    }
+
+    void triangle(uint32_t a, uint32_t b, uint32_t c)
+    {
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+    }
+
+    // corners in order around the quad
+    void quad(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        triangle(a, b, c);
+        triangle(c, d, a);
+    }
+
+    // quads between rows + 1 rows of columns + 1 vertices starting at first
+    void grid(uint32_t first, unsigned int rows, unsigned int columns)
+    {
+        for (unsigned int i = 0; i < rows; i++)
+            for (unsigned int c = 0; c < columns; c++)
+            {
+                uint32_t a = first + i * (columns + 1) + c;
+                quad(a, a + 1, a + columns + 2, a + columns + 1);
+            }
+    }
+
+    // a cylinder's cap at height y, as a fan around its center
+    void disk(const glm::mat4& transform, unsigned int segments, float y, bool facingDown)
+    {
+        const float r = 0.5f * BOX;
+        uint32_t center = vertex(transform, glm::vec3(r, y, r));
+        for (unsigned int s = 0; s <= segments; s++)
+        {
+            float angle = TWO_PI * s / segments;
+            vertex(transform, glm::vec3(r + r * std::cos(angle), y, r + r * std::sin(angle)));
+        }
+        for (unsigned int s = 0; s < segments; s++)
+        {
+            if (facingDown)
+                triangle(center, center + 1 + s, center + 2 + s);
+            else
+                triangle(center, center + 2 + s, center + 1 + s);
+        }
+    }
+};
+
+#endif
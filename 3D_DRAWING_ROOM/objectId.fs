@@ -0,0 +1,10 @@
+#version 330 core
+// object id pass: the id of the object drawn, into an unsigned integer attachment
+uniform int objectId;
+
+layout (location = 0) out uint FragId;
+
+void main()
+{
+    FragId = uint(objectId);
+}
@@ -0,0 +1,20 @@
+#version 330 core
+// object id pass (object_id_pass.h): the same transform as vertexShader.vs, nothing else
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+};
+
+// computed exactly as in vertexShader.vs, so the ids cover the same pixels as the frame
+invariant gl_Position;
+
+void main()
+{
+    vec4 world = model * vec4(aPos, 1.0f);
+    gl_Position = projection * view * world;
+}
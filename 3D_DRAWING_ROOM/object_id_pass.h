@@ -0,0 +1,300 @@
+#pragma once
+
+//
+//  object_id_pass.h
+//  3D Object Drawing
+//
+
+#ifndef OBJECT_ID_PASS_H
+#define OBJECT_ID_PASS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "../common/gl_state.h"
+#include "../common/program_cache.h"
+#include "shader.h"
+
+#include <cstdint>
+#include <iostream>
+
+// the answer to a request: id 0 is the background, frames how many frames after the request
+// it was read back
+struct ObjectIdResult
+{
+    uint32_t id;
+    unsigned long long frames;
+};
+
+// Picking on the rendered geometry: the objects under a pixel are drawn again with their ids
+// into an integer color attachment (GL_R32UI) with its own depth buffer, so the nearest
+// visible surface wins exactly as it did on screen, thin fan blades included.
+//
+// Nothing waits for the GPU:
+//  - begin() binds the pass's framebuffer, scissored to the one pixel asked for, and works
+//    out the planes of that pixel's sliver of the frustum; draw() skips every part outside it,
+//    so a request costs a handful of draws however big the scene is
+//  - end() copies the pixel into a pixel buffer object (glReadPixels into GL_PIXEL_PACK_BUFFER
+//    returns at once) and puts a fence behind it
+//  - poll(), once per loop, looks at the oldest fence without waiting and maps its buffer only
+//    when the copy is done, usually one or two frames after the request
+// Up to LATENCY requests may be in flight; begin() refuses more.
+class ObjectIdPass
+{
+public:
+    enum { LATENCY = 4 };
+
+    // model space box of the mesh, to cull draws against the pixel
+    glm::vec3 LocalMin;
+    glm::vec3 LocalMax;
+    // statistics: requests made and answered, draws and culled draws of the last request
+    unsigned int Requests;
+    unsigned int Answered;
+    unsigned int Draws;
+    unsigned int Culled;
+
+    // call with a current context; frameDataBinding is where the FrameData uniform block
+    // (view, projection) is bound during the frame
+    ObjectIdPass(GLStateCache& state, const char* vertexPath, const char* fragmentPath, unsigned int frameDataBinding, ProgramCache* cache = nullptr) :
+        LocalMin(0.0f), LocalMax(0.0f), Requests(0), Answered(0), Draws(0), Culled(0), state(state), shader(vertexPath, fragmentPath, cache),
+        framebuffer(0), idBuffer(0), depthBuffer(0), width(0), height(0), active(-1), next(0)
+    {
+        shader.setUniformBlock("FrameData", frameDataBinding);
+        shader.State = &state;
+        for (int i = 0; i < LATENCY; i++)
+        {
+            glGenBuffers(1, &slots[i].buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+            slots[i].fence = 0;
+            slots[i].frame = 0;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    ~ObjectIdPass()
+    {
+        release();
+    }
+
+    ObjectIdPass(const ObjectIdPass&) = delete;
+    ObjectIdPass& operator=(const ObjectIdPass&) = delete;
+
+    // true while a request has not been answered yet
+    bool pending() const
+    {
+        for (int i = 0; i < LATENCY; i++)
+            if (slots[i].fence)
+                return true;
+        return false;
+    }
+
+    // start drawing the ids under pixel (framebuffer coordinates, origin bottom left) of a
+    // framebufferSize frame seen through viewProjection; false when the pass cannot take it
+    bool begin(const glm::mat4& viewProjection, const glm::ivec2& pixel, const glm::ivec2& framebufferSize, unsigned long long frame)
+    {
+        if (shader.ID == 0 || slots[next].fence || pixel.x < 0 || pixel.y < 0 || pixel.x >= framebufferSize.x || pixel.y >= framebufferSize.y)
+            return false;
+        if (!resize(framebufferSize))
+            return false;
+
+        // the pixel's sliver of the frustum: its four sides in clip space, plus near and far
+        glm::vec2 size((float)framebufferSize.x, (float)framebufferSize.y);
+        glm::vec2 low = 2.0f * glm::vec2((float)pixel.x, (float)pixel.y) / size - 1.0f;
+        glm::vec2 high = 2.0f * glm::vec2((float)pixel.x + 1.0f, (float)pixel.y + 1.0f) / size - 1.0f;
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        planes[0] = row[0] - low.x * row[3];
+        planes[1] = high.x * row[3] - row[0];
+        planes[2] = row[1] - low.y * row[3];
+        planes[3] = high.y * row[3] - row[1];
+        planes[4] = row[3] + row[2];
+        planes[5] = row[3] - row[2];
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        state.enable(GL_SCISSOR_TEST);
+        glScissor(pixel.x, pixel.y, 1, 1);
+        state.enable(GL_DEPTH_TEST);
+        state.depthMask(true);
+        const GLuint background[4] = { 0, 0, 0, 0 };
+        const GLfloat farDepth = 1.0f;
+        glClearBufferuiv(GL_COLOR, 0, background);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+        shader.use();
+
+        slots[next].frame = frame;
+        this->pixel = pixel;
+        active = next;
+        Draws = 0;
+        Culled = 0;
+        return true;
+    }
+
+    // draw indices [firstIndex, firstIndex + indexCount) of the bound vertex array with model
+    // as object id (not 0); between begin() and end()
+    void draw(const glm::mat4& model, uint32_t firstIndex, uint32_t indexCount, uint32_t id)
+    {
+        if (active < 0)
+            return;
+        if (!touchesPixel(model))
+        {
+            Culled++;
+            return;
+        }
+        shader.setMat4("model", model);
+        shader.setInt("objectId", (int)id);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (const void*)(uintptr_t)(firstIndex * sizeof(GLuint)));
+        Draws++;
+    }
+
+    // queue the copy of the pixel and go back to the default framebuffer
+    void end()
+    {
+        if (active < 0)
+            return;
+        Slot& slot = slots[active];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glReadPixels(pixel.x, pixel.y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        state.disable(GL_SCISSOR_TEST);
+        Requests++;
+        active = -1;
+        next = (next + 1) % LATENCY;
+    }
+
+    // the oldest request, if the GPU is done with it; never waits
+    bool poll(unsigned long long frame, ObjectIdResult& result)
+    {
+        for (int k = 0; k < LATENCY; k++)
+        {
+            Slot& slot = slots[(next + k) % LATENCY];
+            if (!slot.fence)
+                continue;
+            GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+                return false;
+            glDeleteSync(slot.fence);
+            slot.fence = 0;
+            result.id = 0;
+            result.frames = frame - slot.frame;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            const GLuint* mapped = static_cast<const GLuint*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT));
+            if (mapped)
+            {
+                result.id = *mapped;
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            Answered++;
+            return true;
+        }
+        return false;
+    }
+
+    void report() const
+    {
+        std::cout << "object id pass: " << Requests << " requests, " << Answered << " answered; last request " << Draws << " draws, "
+            << Culled << " culled" << std::endl;
+    }
+
+    void release()
+    {
+        for (int i = 0; i < LATENCY; i++)
+        {
+            if (slots[i].fence)
+                glDeleteSync(slots[i].fence);
+            slots[i].fence = 0;
+            if (slots[i].buffer)
+                glDeleteBuffers(1, &slots[i].buffer);
+            slots[i].buffer = 0;
+        }
+        if (framebuffer)
+        {
+            glDeleteFramebuffers(1, &framebuffer);
+            glDeleteRenderbuffers(1, &idBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
+        framebuffer = idBuffer = depthBuffer = 0;
+        if (shader.ID)
+        {
+            state.forgetProgram(shader.ID);
+            glDeleteProgram(shader.ID);
+            shader.ID = 0;
+        }
+    }
+
+private:
+    struct Slot
+    {
+        unsigned int buffer;
+        GLsync fence;
+        unsigned long long frame;
+    };
+
+    GLStateCache& state;
+    Shader shader;
+    unsigned int framebuffer;
+    unsigned int idBuffer;
+    unsigned int depthBuffer;
+    int width;
+    int height;
+    Slot slots[LATENCY];
+    int active;
+    int next;
+    glm::ivec2 pixel;
+    glm::vec4 planes[6];
+
+    // (re)create the attachments at the size of the frame
+    bool resize(const glm::ivec2& size)
+    {
+        if (framebuffer && size.x == width && size.y == height)
+            return true;
+        if (!framebuffer)
+        {
+            glGenFramebuffers(1, &framebuffer);
+            glGenRenderbuffers(1, &idBuffer);
+            glGenRenderbuffers(1, &depthBuffer);
+        }
+        glBindRenderbuffer(GL_RENDERBUFFER, idBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, size.x, size.y);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size.x, size.y);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, idBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::OBJECT_ID_PASS::FRAMEBUFFER_INCOMPLETE: 0x" << std::hex << status << std::dec << std::endl;
+            width = height = 0;
+            return false;
+        }
+        width = size.x;
+        height = size.y;
+        return true;
+    }
+
+    // the mesh box under model against the pixel's planes, as DrawQueue culls against the frustum
+    bool touchesPixel(const glm::mat4& model) const
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (LocalMin + LocalMax), 1.0f));
+        glm::vec3 half = 0.5f * (LocalMax - LocalMin);
+        glm::vec3 extent(0.0f);
+        for (int c = 0; c < 3; c++)
+            extent += glm::abs(glm::vec3(model[c])) * half[c];
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 normal(planes[i]);
+            if (glm::dot(normal, center) + planes[i].w < -glm::dot(glm::abs(normal), extent))
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,547 @@
+#pragma once
+
+//
+//  object_picker.h
+//  3D Object Drawing
+//
+
+#ifndef OBJECT_PICKER_H
+#define OBJECT_PICKER_H
+
+#include <glm/glm.hpp>
+
+#include "scene.h"
+#include "transform_hierarchy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// a picking ray in world space; direction need not be normalized, distances are in its units
+struct PickRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+// the nearest object along a ray: node is the scene node (Scene::NONE for a miss)
+struct PickHit
+{
+    uint32_t node;
+    float distance;
+    glm::vec3 point;
+};
+
+// Ray-cast picking of scene objects. Every node placing a prototype is an object, and each of
+// its parts has a world box; a ray is tested against the boxes first and then against the
+// parts themselves: a part drawing the whole cube is an oriented box (the cube under the part's
+// world matrix, tested in the part's own space), any other part (some of the cube's faces, a
+// generated mesh) is tested triangle by triangle.
+//
+// The parts of every object sit in one bounding volume hierarchy built once with binned
+// surface area heuristic splits (SAH_BINS bins on each axis, a leaf where splitting costs more
+// than testing its parts), so a ray only looks at the parts near it, never at a whole object.
+// The ray walks the tree near child first and skips everything behind the nearest hit so far.
+// Objects under an animated node move every frame: refresh() places them again and refits the
+// tree's boxes around them, keeping its shape.
+class ObjectPicker
+{
+public:
+    // statistics of build()
+    size_t Objects;
+    size_t Parts;
+    size_t MovingObjects;
+    size_t TreeNodes;
+
+    ObjectPicker() : Objects(0), Parts(0), MovingObjects(0), TreeNodes(0), meshMin(0.0f), meshMax(0.0f), boxIndices(0), instance(nullptr)
+    {
+    }
+
+    // vertex positions are the first three floats of every stride floats; the first
+    // boxIndexCount indices (all when 0) draw the box around the whole mesh (the cube), parts
+    // drawing anything else are tested triangle by triangle
+    void setMesh(const float* vertices, size_t vertexCount, size_t stride, const unsigned int* meshIndices, size_t indexCount, size_t boxIndexCount = 0)
+    {
+        boxIndices = boxIndexCount ? boxIndexCount : indexCount;
+        positions.resize(vertexCount);
+        meshMin = glm::vec3(1e30f);
+        meshMax = glm::vec3(-1e30f);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            positions[i] = glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+            meshMin = glm::min(meshMin, positions[i]);
+            meshMax = glm::max(meshMax, positions[i]);
+        }
+        indices.assign(meshIndices, meshIndices + indexCount);
+    }
+
+    // collect the scene's objects and build the tree over them; call after
+    // hierarchy.update()
+    void build(const Scene& scene, const SceneInstance& instance, const TransformHierarchy& hierarchy)
+    {
+        objects.clear();
+        parts.clear();
+        partSlots.clear();
+        partModels.clear();
+        moving.clear();
+        std::vector<unsigned char> animated(scene.Nodes.size(), 0);
+        for (size_t a = 0; a < scene.Animations.size(); a++)
+            animated[scene.Animations[a].node] = 1;
+        for (size_t i = 0; i < scene.Nodes.size(); i++)
+        {
+            if (scene.Nodes[i].parent >= 0 && animated[scene.Nodes[i].parent])
+                animated[i] = 1;
+            if (scene.Nodes[i].prototype == Scene::NONE)
+                continue;
+            const ScenePrototype& prototype = scene.Prototypes[scene.Nodes[i].prototype];
+            Object object = { (uint32_t)i, (uint32_t)parts.size(), prototype.partCount };
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+            {
+                const ScenePart& scenePart = scene.Parts[k];
+                Part part = { glm::mat4(1.0f), glm::vec3(0.0f), (uint32_t)i, glm::vec3(0.0f),
+                    scenePart.firstIndex == 0 && scenePart.indexCount >= boxIndices ? 0u : scenePart.indexCount, scenePart.firstIndex };
+                partSlots.push_back((uint32_t)parts.size());
+                partModels.push_back(scenePart.model);
+                parts.push_back(part);
+            }
+            if (animated[i])
+                moving.push_back((uint32_t)objects.size());
+            objects.push_back(object);
+            place(objects.back(), hierarchy.worldMatrix(instance.Nodes[i]));
+        }
+        this->instance = &instance;
+
+        order.resize(parts.size());
+        for (uint32_t k = 0; k < parts.size(); k++)
+        {
+            order[k] = { parts[k].min, k, parts[k].max, 0.5f * (parts[k].min + parts[k].max) };
+        }
+        nodes.clear();
+        nodes.reserve(2 * order.size());
+        if (!order.empty())
+        {
+            nodes.push_back(TreeNode());
+            split(0, 0, (uint32_t)order.size(), 0);
+        }
+        // the tree keeps its parts in order, so a leaf reads them one after another
+        std::vector<Part> sorted(parts.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+        {
+            sorted[i] = parts[order[i].part];
+            partSlots[order[i].part] = i;
+        }
+        parts.swap(sorted);
+        std::vector<BuildPart>().swap(order);
+        Objects = objects.size();
+        Parts = parts.size();
+        MovingObjects = moving.size();
+        TreeNodes = nodes.size();
+    }
+
+    // place the moving objects at their current world matrices and refit the tree around them;
+    // call after hierarchy.update()
+    void refresh(const TransformHierarchy& hierarchy)
+    {
+        if (moving.empty())
+            return;
+        for (size_t m = 0; m < moving.size(); m++)
+        {
+            const Object& object = objects[moving[m]];
+            place(object, hierarchy.worldMatrix(instance->Nodes[object.node]));
+        }
+        // children come after their parent, so walking backwards sees them first
+        for (size_t n = nodes.size(); n-- > 0; )
+        {
+            TreeNode& node = nodes[n];
+            if (node.count > 0)
+            {
+                node.min = glm::vec3(1e30f);
+                node.max = glm::vec3(-1e30f);
+                for (uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    node.min = glm::min(node.min, parts[i].min);
+                    node.max = glm::max(node.max, parts[i].max);
+                }
+            }
+            else
+            {
+                node.min = glm::min(nodes[node.first].min, nodes[node.first + 1].min);
+                node.max = glm::max(nodes[node.first].max, nodes[node.first + 1].max);
+            }
+        }
+    }
+
+    // the ray through pixel (x right, y down, as window coordinates) of a viewport, unprojected
+    // with the camera's inverse view-projection (Camera::GetInverseViewProjectionMatrix)
+    static PickRay rayThroughPixel(const glm::mat4& inverseViewProjection, const glm::vec2& pixel, const glm::vec2& viewport)
+    {
+        glm::vec2 ndc(2.0f * pixel.x / viewport.x - 1.0f, 1.0f - 2.0f * pixel.y / viewport.y);
+        glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+        glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+        PickRay ray;
+        ray.origin = glm::vec3(nearPoint) / nearPoint.w;
+        ray.direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - ray.origin);
+        return ray;
+    }
+
+    // nearest object hit within maxDistance
+    PickHit pick(const PickRay& ray, float maxDistance = 1e30f) const
+    {
+        PickHit hit = { Scene::NONE, maxDistance, glm::vec3(0.0f) };
+        const RaySlabs slabs = { safeInverse(ray.direction), ray.origin * safeInverse(ray.direction) };
+        if (!nodes.empty() && boxEntry(nodes[0].min, nodes[0].max, slabs, hit.distance) < MISS)
+        {
+            // a pending child and the distance at which the ray enters it
+            uint32_t stack[STACK_SIZE];
+            float entries[STACK_SIZE];
+            int depth = 0;
+            uint32_t current = 0;
+            for (;;)
+            {
+                const TreeNode& node = nodes[current];
+                if (node.count > 0)
+                {
+                    for (uint32_t i = node.first; i < node.first + node.count; i++)
+                        testPart(parts[i], ray, slabs, hit);
+                }
+                else
+                {
+                    // nearer child first, the other one later unless a hit got in front of it
+                    uint32_t a = node.first, b = node.first + 1;
+                    float ta = boxEntry(nodes[a].min, nodes[a].max, slabs, hit.distance);
+                    float tb = boxEntry(nodes[b].min, nodes[b].max, slabs, hit.distance);
+                    if (ta > tb)
+                    {
+                        std::swap(a, b);
+                        std::swap(ta, tb);
+                    }
+                    if (ta < MISS)
+                    {
+                        if (tb < MISS)
+                        {
+                            stack[depth] = b;
+                            entries[depth++] = tb;
+                        }
+                        current = a;
+                        continue;
+                    }
+                }
+                // next pending child that can still beat the nearest hit
+                while (depth > 0 && entries[depth - 1] >= hit.distance)
+                    depth--;
+                if (depth == 0)
+                    break;
+                current = stack[--depth];
+            }
+        }
+        if (hit.node != Scene::NONE)
+            hit.point = ray.origin + ray.direction * hit.distance;
+        return hit;
+    }
+
+    // pick along count rays at once (hover over a grid of pixels, say)
+    void pick(const PickRay* rays, size_t count, PickHit* hits, float maxDistance = 1e30f) const
+    {
+        for (size_t i = 0; i < count; i++)
+            hits[i] = pick(rays[i], maxDistance);
+    }
+
+    // pick through count pixels of a viewport
+    void pickPixels(const glm::mat4& inverseViewProjection, const glm::vec2& viewport, const glm::vec2* pixels, size_t count, PickHit* hits) const
+    {
+        for (size_t i = 0; i < count; i++)
+            hits[i] = pick(rayThroughPixel(inverseViewProjection, pixels[i], viewport));
+    }
+
+private:
+    // SAH: a leaf costs its part count, a split one traversal step plus the parts a ray is
+    // expected to test below it; leaves never hold more than MAX_LEAF_SIZE parts. Below
+    // SAH_DEPTH the splits are at the median, which bounds the depth for the stack.
+    enum { SAH_BINS = 16, MAX_LEAF_SIZE = 8, SAH_DEPTH = 40, STACK_SIZE = 64 };
+    static constexpr float TRAVERSAL_COST = 1.0f;
+    // boxEntry() of a box the ray misses or reaches only behind the nearest hit
+    static constexpr float MISS = 1e30f;
+
+    struct Object
+    {
+        uint32_t node;
+        uint32_t firstPart;
+        uint32_t partCount;
+    };
+
+    // toLocal takes world space into the mesh's space of the part, min/max is its world box;
+    // node is the scene node of its object, triangleIndices 0 for the whole cube (tested as an
+    // oriented box) and otherwise the indices tested triangle by triangle from firstIndex
+    struct Part
+    {
+        glm::mat4 toLocal;
+        glm::vec3 min;
+        uint32_t node;
+        glm::vec3 max;
+        uint32_t triangleIndices;
+        uint32_t firstIndex;
+    };
+
+    // the ray as the slab test wants it: t = box * inverse - scaledOrigin on each axis
+    struct RaySlabs
+    {
+        glm::vec3 inverse;
+        glm::vec3 scaledOrigin;
+    };
+
+    struct BuildPart
+    {
+        glm::vec3 min;
+        uint32_t part;
+        glm::vec3 max;
+        glm::vec3 center;
+    };
+
+    // an inner node's children are nodes[first] and nodes[first + 1]; a leaf (count > 0)
+    // holds parts[first, + count)
+    struct TreeNode
+    {
+        glm::vec3 min;
+        uint32_t first;
+        glm::vec3 max;
+        uint32_t count;
+    };
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    glm::vec3 meshMin;
+    glm::vec3 meshMax;
+    size_t boxIndices;
+    std::vector<Object> objects;
+    // in tree order after build(); an object's part k is parts[partSlots[firstPart + k]]
+    std::vector<Part> parts;
+    std::vector<uint32_t> partSlots;
+    // the parts' model matrices, in object order: only place() reads them
+    std::vector<glm::mat4> partModels;
+    std::vector<uint32_t> moving;
+    // build() only: the parts being split, with their boxes and box centers
+    std::vector<BuildPart> order;
+    std::vector<TreeNode> nodes;
+    const SceneInstance* instance;
+
+    void place(const Object& object, const glm::mat4& world)
+    {
+        for (uint32_t k = object.firstPart; k < object.firstPart + object.partCount; k++)
+        {
+            Part& part = parts[partSlots[k]];
+            glm::mat4 model = world * partModels[k];
+            part.toLocal = glm::inverse(model);
+            part.min = glm::vec3(1e30f);
+            part.max = glm::vec3(-1e30f);
+            for (int c = 0; c < 8; c++)
+            {
+                glm::vec3 corner((c & 1) ? meshMax.x : meshMin.x, (c & 2) ? meshMax.y : meshMin.y, (c & 4) ? meshMax.z : meshMin.z);
+                glm::vec3 p = glm::vec3(model * glm::vec4(corner, 1.0f));
+                part.min = glm::min(part.min, p);
+                part.max = glm::max(part.max, p);
+            }
+        }
+    }
+
+    static float halfArea(const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 d = glm::max(max - min, glm::vec3(0.0f));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    void split(uint32_t index, uint32_t first, uint32_t last, int depth)
+    {
+        glm::vec3 min(1e30f), max(-1e30f), centerMin(1e30f), centerMax(-1e30f);
+        for (uint32_t i = first; i < last; i++)
+        {
+            const BuildPart& part = order[i];
+            min = glm::min(min, part.min);
+            max = glm::max(max, part.max);
+            centerMin = glm::min(centerMin, part.center);
+            centerMax = glm::max(centerMax, part.center);
+        }
+        nodes[index].min = min;
+        nodes[index].max = max;
+        const uint32_t count = last - first;
+        glm::vec3 extent = centerMax - centerMin;
+        if (count == 1 || (count <= MAX_LEAF_SIZE && extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f))
+        {
+            nodes[index].first = first;
+            nodes[index].count = count;
+            return;
+        }
+
+        // the cheapest plane between SAH_BINS bins of the centers, on every axis
+        int bestAxis = -1, bestPlane = 0;
+        float bestCost = 1e30f;
+        if (depth < SAH_DEPTH)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (extent[axis] <= 0.0f)
+                    continue;
+                const float scale = SAH_BINS / extent[axis];
+                glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+                uint32_t binCount[SAH_BINS] = {};
+                for (int b = 0; b < SAH_BINS; b++)
+                {
+                    binMin[b] = glm::vec3(1e30f);
+                    binMax[b] = glm::vec3(-1e30f);
+                }
+                for (uint32_t i = first; i < last; i++)
+                {
+                    const BuildPart& part = order[i];
+                    int b = std::min(SAH_BINS - 1, (int)((part.center[axis] - centerMin[axis]) * scale));
+                    binCount[b]++;
+                    binMin[b] = glm::min(binMin[b], part.min);
+                    binMax[b] = glm::max(binMax[b], part.max);
+                }
+                // right[p]: cost of everything above plane p, swept from the top
+                float right[SAH_BINS];
+                glm::vec3 sweepMin(1e30f), sweepMax(-1e30f);
+                uint32_t sweepCount = 0;
+                for (int b = SAH_BINS - 1; b > 0; b--)
+                {
+                    sweepMin = glm::min(sweepMin, binMin[b]);
+                    sweepMax = glm::max(sweepMax, binMax[b]);
+                    sweepCount += binCount[b];
+                    right[b] = sweepCount ? halfArea(sweepMin, sweepMax) * sweepCount : 0.0f;
+                }
+                sweepMin = glm::vec3(1e30f);
+                sweepMax = glm::vec3(-1e30f);
+                sweepCount = 0;
+                for (int b = 1; b < SAH_BINS; b++)
+                {
+                    sweepMin = glm::min(sweepMin, binMin[b - 1]);
+                    sweepMax = glm::max(sweepMax, binMax[b - 1]);
+                    sweepCount += binCount[b - 1];
+                    if (sweepCount == 0 || sweepCount == count)
+                        continue;
+                    float cost = halfArea(sweepMin, sweepMax) * sweepCount + right[b];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestPlane = b;
+                    }
+                }
+            }
+        }
+
+        uint32_t middle = first;
+        if (bestAxis >= 0)
+        {
+            float area = halfArea(min, max);
+            if (count <= MAX_LEAF_SIZE && (area <= 0.0f || TRAVERSAL_COST + bestCost / area >= (float)count))
+            {
+                nodes[index].first = first;
+                nodes[index].count = count;
+                return;
+            }
+            const float scale = SAH_BINS / extent[bestAxis];
+            const float low = centerMin[bestAxis];
+            middle = (uint32_t)(std::partition(order.begin() + first, order.begin() + last, [&](const BuildPart& part)
+            {
+                return std::min(SAH_BINS - 1, (int)((part.center[bestAxis] - low) * scale)) < bestPlane;
+            }) - order.begin());
+        }
+        if (middle == first || middle == last)
+        {
+            // deep in the tree or no plane parts the centers: split at the median instead
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            middle = (first + last) / 2;
+            std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + last, [&](const BuildPart& a, const BuildPart& b)
+            {
+                return a.center[axis] < b.center[axis];
+            });
+        }
+        uint32_t children = (uint32_t)nodes.size();
+        nodes[index].first = children;
+        nodes[index].count = 0;
+        nodes.push_back(TreeNode());
+        nodes.push_back(TreeNode());
+        split(children, first, middle, depth + 1);
+        split(children + 1, middle, last, depth + 1);
+    }
+
+    static glm::vec3 safeInverse(const glm::vec3& d)
+    {
+        return glm::vec3(std::fabs(d.x) > 1e-20f ? 1.0f / d.x : 1e30f, std::fabs(d.y) > 1e-20f ? 1.0f / d.y : 1e30f,
+            std::fabs(d.z) > 1e-20f ? 1.0f / d.z : 1e30f);
+    }
+
+    // distance at which the ray enters [min, max] (0 when it starts inside), MISS when it
+    // misses or gets there beyond limit
+    static float boxEntry(const glm::vec3& min, const glm::vec3& max, const RaySlabs& ray, float limit)
+    {
+        // per axis, so the compiler keeps everything in registers
+        float x0 = min.x * ray.inverse.x - ray.scaledOrigin.x, x1 = max.x * ray.inverse.x - ray.scaledOrigin.x;
+        float y0 = min.y * ray.inverse.y - ray.scaledOrigin.y, y1 = max.y * ray.inverse.y - ray.scaledOrigin.y;
+        float z0 = min.z * ray.inverse.z - ray.scaledOrigin.z, z1 = max.z * ray.inverse.z - ray.scaledOrigin.z;
+        float enter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+        float exit = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), limit));
+        return enter <= exit ? enter : MISS;
+    }
+
+    void testPart(const Part& part, const PickRay& ray, const RaySlabs& slabs, PickHit& hit) const
+    {
+        if (boxEntry(part.min, part.max, slabs, hit.distance) >= MISS)
+            return;
+        // in the part's space the distance along the ray is the same parameter
+        glm::vec3 origin = glm::vec3(part.toLocal * glm::vec4(ray.origin, 1.0f));
+        glm::vec3 direction = glm::vec3(part.toLocal * glm::vec4(ray.direction, 0.0f));
+        float t = part.triangleIndices == 0 ? boxSurface(origin, direction, hit.distance)
+            : triangles(part, origin, direction, hit.distance);
+        if (t < hit.distance)
+        {
+            hit.distance = t;
+            hit.node = part.node;
+        }
+    }
+
+    // first point on the surface of the mesh's box: where the ray enters it, or where it
+    // leaves it when it starts inside; MISS when not before limit
+    float boxSurface(const glm::vec3& origin, const glm::vec3& direction, float limit) const
+    {
+        glm::vec3 inverse = safeInverse(direction);
+        glm::vec3 t0 = (meshMin - origin) * inverse, t1 = (meshMax - origin) * inverse;
+        glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+        float enter = std::max(std::max(near.x, near.y), near.z);
+        float exit = std::min(std::min(far.x, far.y), far.z);
+        if (enter > exit || exit < 0.0f)
+            return MISS;
+        float t = enter >= 0.0f ? enter : exit;
+        return t < limit ? t : MISS;
+    }
+
+    // nearest of the part's triangles (Moller-Trumbore), both sides
+    float triangles(const Part& part, const glm::vec3& origin, const glm::vec3& direction, float limit) const
+    {
+        float best = MISS;
+        for (uint32_t i = part.firstIndex; i + 3 <= part.firstIndex + part.triangleIndices && i + 3 <= indices.size(); i += 3)
+        {
+            const glm::vec3& a = positions[indices[i]];
+            glm::vec3 ab = positions[indices[i + 1]] - a, ac = positions[indices[i + 2]] - a;
+            glm::vec3 p = glm::cross(direction, ac);
+            float determinant = glm::dot(ab, p);
+            if (std::fabs(determinant) < 1e-12f)
+                continue;
+            float inverseDeterminant = 1.0f / determinant;
+            glm::vec3 s = origin - a;
+            float u = glm::dot(s, p) * inverseDeterminant;
+            if (u < 0.0f || u > 1.0f)
+                continue;
+            glm::vec3 q = glm::cross(s, ab);
+            float v = glm::dot(direction, q) * inverseDeterminant;
+            if (v < 0.0f || u + v > 1.0f)
+                continue;
+            float t = glm::dot(ac, q) * inverseDeterminant;
+            if (t >= 0.0f && t < limit && t < best)
+                best = t;
+        }
+        return best;
+    }
+};
+
+#endif
@@ -0,0 +1,467 @@
+#pragma once
+
+//
+//  occlusion_culler.h
+//  3D Object Drawing
+//
+
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include "transform_batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Software occlusion culling:
+//  1. begin() each frame, then addOccluder() for big boxes (walls, ceiling, slab, sofa ...)
+//  2. rasterize() keeps the MaxOccluders largest on screen, draws their faces into a small
+//     CPU depth buffer (BatchLane wide, SSE2 / AVX2 / NEON) and builds a max-depth pyramid
+//  3. isVisible() tests a world box: its nearest depth against the farthest depth of the 2x2
+//     pyramid texels it covers; nothing nearer than every occluder there means hidden
+// The depth buffer only holds what was rasterized, so a box is never rejected by something
+// that is not drawn. A texel only takes a face's depth when the face covers all of it, and then
+// the farthest depth of the face over the texel, so rejection stays conservative at occluder
+// edges. Faces are the mesh's triangles with each coplanar pair sharing an edge (the cube's
+// quads) merged into one, so quad diagonals leave no gaps. Boxes crossing the near plane are
+// always visible.
+//
+// Depth is window depth (0 near, 1 far), rows go bottom to top like GL's.
+class OcclusionCuller
+{
+public:
+    // depth buffer size; the width is a multiple of every BatchLane width
+    enum { WIDTH = 256, HEIGHT = 128 };
+
+    unsigned int MaxOccluders;
+    // boxes whose two larger sides (under their model matrix) are shorter are not worth it
+    float MinOccluderSize;
+    // statistics of the last frame
+    unsigned int Candidates;
+    unsigned int Occluders;
+    unsigned int Polygons;
+    unsigned int Tested;
+    unsigned int Rejected;
+    double RasterSeconds;
+    // totals over every frame, for report()
+    unsigned int Frames;
+    unsigned long long TotalTested;
+    unsigned long long TotalRejected;
+    double TotalRasterSeconds;
+
+    OcclusionCuller(unsigned int maxOccluders = 128, float minOccluderSize = 0.5f) : MaxOccluders(maxOccluders), MinOccluderSize(minOccluderSize),
+        Candidates(0), Occluders(0), Polygons(0), Tested(0), Rejected(0), RasterSeconds(0.0),
+        Frames(0), TotalTested(0), TotalRejected(0), TotalRasterSeconds(0.0), viewProjection(1.0f), meshMin(0.0f), meshMax(0.0f)
+    {
+        int width = WIDTH, height = HEIGHT;
+        while (width >= 1 && height >= 1)
+        {
+            Level level = { width, height, std::vector<float>((size_t)width * height, 1.0f) };
+            levels.push_back(level);
+            width /= 2;
+            height /= 2;
+        }
+    }
+
+    // positions of the mesh the occluders index into: vertexCount vertices, stride floats apart
+    void setMesh(const float* vertices, size_t vertexCount, size_t stride, const unsigned int* meshIndices, size_t indexCount)
+    {
+        positions.resize(vertexCount);
+        meshMin = glm::vec3(1e30f);
+        meshMax = glm::vec3(-1e30f);
+        for (size_t i = 0; i < vertexCount; i++)
+        {
+            positions[i] = glm::vec3(vertices[i * stride], vertices[i * stride + 1], vertices[i * stride + 2]);
+            meshMin = glm::min(meshMin, positions[i]);
+            meshMax = glm::max(meshMax, positions[i]);
+        }
+        indices.assign(meshIndices, meshIndices + indexCount);
+        clip.resize(vertexCount);
+        size_t triangles = indexCount / 3;
+        quads.assign(triangles * 4, 0);
+        quadWithNext.assign(triangles, 0);
+        for (size_t t = 0; t + 1 < triangles; t++)
+            quadWithNext[t] = findQuad(t) ? 1 : 0;
+    }
+
+    // true when a part drawn with model is big enough to be an occluder
+    bool isOccluderShape(const glm::mat4& model) const
+    {
+        glm::vec3 size = meshMax - meshMin;
+        float sides[3];
+        for (int c = 0; c < 3; c++)
+            sides[c] = glm::length(glm::vec3(model[c])) * size[c];
+        std::sort(sides, sides + 3);
+        return sides[1] >= MinOccluderSize;
+    }
+
+    // start a frame seen through viewProjection (projection * view) with the six frustum planes
+    // of the same matrix, normals pointing inside (Camera::GetFrustumPlanes)
+    void begin(const glm::mat4& matrix, const glm::vec4* planes)
+    {
+        viewProjection = matrix;
+        for (int i = 0; i < 6; i++)
+            frustum[i] = planes[i];
+        viewW = glm::vec4(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+        candidates.clear();
+        Tested = 0;
+        Rejected = 0;
+    }
+
+    // a box of the mesh drawn with model from indices [firstIndex, firstIndex + indexCount);
+    // off-screen ones are dropped here
+    void addOccluder(const glm::mat4& model, uint32_t firstIndex, uint32_t indexCount)
+    {
+        glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (meshMin + meshMax), 1.0f));
+        glm::vec3 half = 0.5f * (meshMax - meshMin);
+        float radius = glm::length(glm::abs(glm::vec3(model[0])) * half.x + glm::abs(glm::vec3(model[1])) * half.y
+            + glm::abs(glm::vec3(model[2])) * half.z);
+        for (int i = 0; i < 6; i++)
+            if (glm::dot(glm::vec3(frustum[i]), center) + frustum[i].w < -radius)
+                return;
+        // bigger and nearer first; boxes reaching the eye count as the biggest
+        float distance = glm::dot(viewW, glm::vec4(center, 1.0f)) - radius;
+        Occluder occluder = { model, firstIndex, indexCount, distance > 1e-3f ? radius / distance : 1e30f };
+        candidates.push_back(occluder);
+    }
+
+    // draw the best occluders and build the pyramid; isVisible() is valid after this
+    void rasterize()
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Candidates = (unsigned int)candidates.size();
+        if (candidates.size() > MaxOccluders)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + MaxOccluders, candidates.end(), largerOnScreen);
+            candidates.resize(MaxOccluders);
+        }
+        std::fill(levels[0].depth.begin(), levels[0].depth.end(), 1.0f);
+        Polygons = 0;
+        for (size_t i = 0; i < candidates.size(); i++)
+            drawOccluder(candidates[i]);
+        Occluders = (unsigned int)candidates.size();
+        buildPyramid();
+
+        RasterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Frames++;
+        TotalRasterSeconds += RasterSeconds;
+    }
+
+    // false when the world box is certainly behind the rasterized occluders
+    bool isVisible(const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        Tested++;
+        TotalTested++;
+        glm::vec2 low(1e30f), high(-1e30f);
+        float nearest = 1.0f;
+        for (int c = 0; c < 8; c++)
+        {
+            glm::vec4 p = viewProjection * glm::vec4((c & 1) ? boxMax.x : boxMin.x, (c & 2) ? boxMax.y : boxMin.y, (c & 4) ? boxMax.z : boxMin.z, 1.0f);
+            if (p.z < -p.w || p.w <= 0.0f)
+                return true;
+            glm::vec2 screen = toScreen(p);
+            low = glm::min(low, screen);
+            high = glm::max(high, screen);
+            nearest = std::min(nearest, 0.5f * p.z / p.w + 0.5f);
+        }
+        // outside the buffer is the frustum's business
+        if (high.x < 0.0f || high.y < 0.0f || low.x >= (float)WIDTH || low.y >= (float)HEIGHT)
+            return true;
+        int x0 = std::max(0, (int)low.x), x1 = std::min(WIDTH - 1, (int)high.x);
+        int y0 = std::max(0, (int)low.y), y1 = std::min(HEIGHT - 1, (int)high.y);
+
+        // the level where the rectangle covers at most 2x2 texels
+        size_t l = 0;
+        while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1))
+            l++;
+        const Level& level = levels[l];
+        for (int y = y0 >> l; y <= (y1 >> l); y++)
+            for (int x = x0 >> l; x <= (x1 >> l); x++)
+                if (nearest <= level.depth[(size_t)y * level.width + x])
+                    return true;
+        Rejected++;
+        TotalRejected++;
+        return false;
+    }
+
+    // depth buffer of the last rasterize(), WIDTH * HEIGHT values
+    const float* depth() const
+    {
+        return levels[0].depth.data();
+    }
+
+    void report() const
+    {
+        if (Frames == 0)
+            return;
+        std::cout << "occlusion culling (" << BatchLane::name() << ", " << WIDTH << "x" << HEIGHT << "): "
+            << (TotalTested ? 100.0 * TotalRejected / TotalTested : 0.0) << "% of " << TotalTested / Frames
+            << " tested boxes per frame rejected, rasterizing took " << 1000.0 * TotalRasterSeconds / Frames << " ms" << std::endl;
+        std::cout << "  last frame: " << Occluders << " of " << Candidates << " occluders, " << Polygons << " faces, "
+            << Rejected << " of " << Tested << " boxes rejected" << std::endl;
+    }
+
+private:
+    struct Level
+    {
+        int width;
+        int height;
+        std::vector<float> depth;
+    };
+
+    struct Occluder
+    {
+        glm::mat4 model;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float score;
+    };
+
+    // a face clipped by the near plane gains one corner
+    enum { MAX_CORNERS = 5 };
+
+    // x, y in pixels and window depth
+    struct ScreenVertex
+    {
+        float x, y, z;
+    };
+
+    glm::mat4 viewProjection;
+    glm::vec4 frustum[6];
+    // w row of viewProjection: view depth of a point
+    glm::vec4 viewW;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    // per triangle: 1 when it and the next one form a quad, whose corners are in quads
+    std::vector<unsigned char> quadWithNext;
+    std::vector<unsigned int> quads;
+    std::vector<glm::vec4> clip;
+    glm::vec3 meshMin;
+    glm::vec3 meshMax;
+    std::vector<Occluder> candidates;
+    // levels[0] is the depth buffer, each next level the max of 2x2 texels of the one before
+    std::vector<Level> levels;
+
+    static bool largerOnScreen(const Occluder& a, const Occluder& b)
+    {
+        return a.score > b.score;
+    }
+
+    static glm::vec2 toScreen(const glm::vec4& p)
+    {
+        return glm::vec2((0.5f * p.x / p.w + 0.5f) * WIDTH, (0.5f * p.y / p.w + 0.5f) * HEIGHT);
+    }
+
+    void drawOccluder(const Occluder& occluder)
+    {
+        glm::mat4 matrix = viewProjection * occluder.model;
+        for (size_t i = 0; i < positions.size(); i++)
+            clip[i] = matrix * glm::vec4(positions[i], 1.0f);
+        uint32_t last = std::min<uint32_t>(occluder.firstIndex + occluder.indexCount, (uint32_t)indices.size());
+        for (uint32_t i = occluder.firstIndex; i + 3 <= last; )
+        {
+            size_t triangle = i / 3;
+            if (i + 6 <= last && quadWithNext[triangle])
+            {
+                clipPolygon(&quads[triangle * 4], 4);
+                i += 6;
+            }
+            else
+            {
+                clipPolygon(&indices[i], 3);
+                i += 3;
+            }
+        }
+    }
+
+    // triangle t and t + 1 as one convex quad when they share an edge and lie in one plane;
+    // the corners go to quads[t * 4 ..] in order around the quad
+    bool findQuad(size_t t)
+    {
+        const unsigned int* a = &indices[t * 3];
+        const unsigned int* b = &indices[t * 3 + 3];
+        // the corner of each triangle that is not on the shared edge
+        int loneA = -1, loneB = -1, shared = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            bool inB = a[i] == b[0] || a[i] == b[1] || a[i] == b[2];
+            bool inA = b[i] == a[0] || b[i] == a[1] || b[i] == a[2];
+            shared += inB ? 1 : 0;
+            if (!inB)
+                loneA = i;
+            if (!inA)
+                loneB = i;
+        }
+        if (shared != 2 || loneA < 0 || loneB < 0)
+            return false;
+        unsigned int* quad = &quads[t * 4];
+        quad[0] = a[loneA];
+        quad[1] = a[(loneA + 1) % 3];
+        quad[2] = b[loneB];
+        quad[3] = a[(loneA + 2) % 3];
+
+        const glm::vec3 p[4] = { positions[quad[0]], positions[quad[1]], positions[quad[2]], positions[quad[3]] };
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[3] - p[0]);
+        float length = glm::length(normal);
+        float extent = glm::length(p[2] - p[0]) + glm::length(p[3] - p[1]);
+        if (length < 1e-12f || std::fabs(glm::dot(normal, p[2] - p[0])) > 1e-4f * length * extent)
+            return false;
+        for (int i = 0; i < 4; i++)
+            if (glm::dot(glm::cross(p[(i + 1) % 4] - p[i], p[(i + 2) % 4] - p[(i + 1) % 4]), normal) <= 0.0f)
+                return false;
+        return true;
+    }
+
+    // cut the face at the near plane (z = -w) and draw what is in front
+    void clipPolygon(const unsigned int* corners, int count)
+    {
+        glm::vec4 out[MAX_CORNERS];
+        int kept = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const glm::vec4& p = clip[corners[i]];
+            const glm::vec4& q = clip[corners[(i + 1) % count]];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0.0f)
+                out[kept++] = p;
+            if ((dp >= 0.0f) != (dq >= 0.0f))
+                out[kept++] = p + (q - p) * (dp / (dp - dq));
+        }
+        if (kept < 3)
+            return;
+        ScreenVertex screen[MAX_CORNERS];
+        for (int i = 0; i < kept; i++)
+        {
+            if (out[i].w <= 0.0f)
+                return;
+            glm::vec2 xy = toScreen(out[i]);
+            ScreenVertex v = { xy.x, xy.y, 0.5f * out[i].z / out[i].w + 0.5f };
+            screen[i] = v;
+        }
+        drawPolygon(screen, kept);
+    }
+
+    // half-space rasterizer for a convex face, BatchLane::WIDTH pixels at a time; a pixel is
+    // covered only when the whole texel is inside every edge, and keeps the nearest of the
+    // face's farthest depth over the texel and what it held
+    void drawPolygon(const ScreenVertex* v, int count)
+    {
+        typedef BatchLane L;
+        typedef L::type V;
+        float area = 0.0f;
+        for (int i = 0; i < count; i++)
+        {
+            const ScreenVertex& p = v[i];
+            const ScreenVertex& q = v[(i + 1) % count];
+            area += p.x * q.y - q.x * p.y;
+        }
+        if (std::fabs(area) < 1e-8f)
+            return;
+        const float side = area > 0.0f ? 1.0f : -1.0f;
+
+        float left = v[0].x, right = v[0].x, bottom = v[0].y, top = v[0].y;
+        for (int i = 1; i < count; i++)
+        {
+            left = std::min(left, v[i].x);
+            right = std::max(right, v[i].x);
+            bottom = std::min(bottom, v[i].y);
+            top = std::max(top, v[i].y);
+        }
+        int minX = std::max(0, (int)std::floor(left));
+        int maxX = std::min(WIDTH - 1, (int)std::ceil(right));
+        int minY = std::max(0, (int)std::floor(bottom));
+        int maxY = std::min(HEIGHT - 1, (int)std::ceil(top));
+        if (minX > maxX || minY > maxY)
+            return;
+        minX -= minX % L::WIDTH;
+        Polygons++;
+
+        // edge i runs from corner i to the next and is positive inside; moving it in by half the
+        // texel's extent along its normal makes it test the texel's farthest corner
+        float ea[MAX_CORNERS], eb[MAX_CORNERS], ec[MAX_CORNERS];
+        for (int i = 0; i < count; i++)
+        {
+            const ScreenVertex& p = v[i];
+            const ScreenVertex& q = v[(i + 1) % count];
+            ea[i] = side * (p.y - q.y);
+            eb[i] = side * (q.x - p.x);
+            ec[i] = side * (p.x * q.y - p.y * q.x) - 0.5f * (std::fabs(ea[i]) + std::fabs(eb[i]));
+        }
+
+        // the depth plane from the widest fan triangle, pushed back to the texel's farthest corner
+        int widest = 1;
+        float widestArea = 0.0f;
+        for (int i = 1; i + 1 < count; i++)
+        {
+            float fan = std::fabs((v[i].x - v[0].x) * (v[i + 1].y - v[0].y) - (v[i + 1].x - v[0].x) * (v[i].y - v[0].y));
+            if (fan > widestArea)
+            {
+                widestArea = fan;
+                widest = i;
+            }
+        }
+        const ScreenVertex& v0 = v[0];
+        const ScreenVertex& v1 = v[widest];
+        const ScreenVertex& v2 = v[widest + 1];
+        float planeArea = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        float dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / planeArea;
+        float dzdy = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / planeArea;
+        float z0 = v0.z - dzdx * v0.x - dzdy * v0.y + 0.5f * (std::fabs(dzdx) + std::fabs(dzdy));
+
+        // pixel center x of each lane
+        float laneX[L::WIDTH];
+        for (int k = 0; k < L::WIDTH; k++)
+            laneX[k] = (float)k + 0.5f;
+        const V offsets = L::load(laneX);
+        V a[MAX_CORNERS], eRow[MAX_CORNERS];
+        for (int i = 0; i < count; i++)
+            a[i] = L::set1(ea[i]);
+        const V az = L::set1(dzdx);
+
+        std::vector<float>& buffer = levels[0].depth;
+        for (int y = minY; y <= maxY; y++)
+        {
+            float py = (float)y + 0.5f;
+            for (int i = 0; i < count; i++)
+                eRow[i] = L::set1(eb[i] * py + ec[i]);
+            V zRow = L::set1(dzdy * py + z0);
+            float* row = &buffer[(size_t)y * WIDTH];
+            for (int x = minX; x <= maxX; x += L::WIDTH)
+            {
+                V px = L::add(L::set1((float)x), offsets);
+                V inside = L::madd(a[0], px, eRow[0]);
+                for (int i = 1; i < count; i++)
+                    inside = L::min(inside, L::madd(a[i], px, eRow[i]));
+                V old = L::load(row + x);
+                V z = L::madd(az, px, zRow);
+                L::store(row + x, L::min(old, L::selectNonNegative(inside, z, old)));
+            }
+        }
+    }
+
+    void buildPyramid()
+    {
+        for (size_t l = 1; l < levels.size(); l++)
+        {
+            const Level& fine = levels[l - 1];
+            Level& coarse = levels[l];
+            for (int y = 0; y < coarse.height; y++)
+            {
+                const float* top = &fine.depth[(size_t)(2 * y) * fine.width];
+                const float* bottom = top + fine.width;
+                float* out = &coarse.depth[(size_t)y * coarse.width];
+                for (int x = 0; x < coarse.width; x++)
+                    out[x] = std::max(std::max(top[2 * x], top[2 * x + 1]), std::max(bottom[2 * x], bottom[2 * x + 1]));
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,326 @@
+#pragma once
+
+//
+//  portal_visibility.h
+//  3D Object Drawing
+//
+
+#ifndef PORTAL_VISIBILITY_H
+#define PORTAL_VISIBILITY_H
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Cell and portal visibility. Cells are world boxes (rooms), portals are convex quads in a
+// cell's boundary (windows, doorways, open sides) leading out of it. link() finds the cell
+// behind every portal; portals with nothing behind them open to the outside.
+//
+// update() walks the cells each frame:
+//  - from the camera's cell, every portal facing the camera is clipped against the current
+//    frustum; if anything is left, the cell behind it is visible and is walked in turn with
+//    the frustum narrowed to the planes through the eye and the clipped portal's edges
+//  - portals are never clipped by the near plane: its sides already meet at the eye, and an
+//    opening the eye is closer to than the near distance still has to let the cell through
+//  - a camera outside every cell starts at the portals that open to the outside
+// Only cells reached this way are visible, so the work and what gets drawn depend on what
+// can be seen through the openings and not on how many cells there are. The result is
+// conservative: a cell is only ever skipped when no line of sight through portals reaches it.
+class PortalVisibility
+{
+public:
+    enum { NONE = 0xFFFFFFFFu };
+
+    unsigned int MaxDepth;
+    // statistics of the last update()
+    uint32_t CameraCell;
+    unsigned int VisibleCells;
+    unsigned int PortalsTested;
+    double Seconds;
+
+    PortalVisibility() : MaxDepth(64), CameraCell(NONE), VisibleCells(0), PortalsTested(0), Seconds(0.0), bucketSize(1.0f), frame(0)
+    {
+    }
+
+    void clear()
+    {
+        cells.clear();
+        portals.clear();
+        buckets.clear();
+        visibleFrame.clear();
+        onPath.clear();
+    }
+
+    size_t cellCount() const
+    {
+        return cells.size();
+    }
+
+    // a world box; returns its index
+    uint32_t addCell(const glm::vec3& boxMin, const glm::vec3& boxMax)
+    {
+        Cell cell = { boxMin, boxMax, (uint32_t)portals.size(), 0 };
+        cells.push_back(cell);
+        visibleFrame.push_back(0);
+        onPath.push_back(0);
+        return (uint32_t)cells.size() - 1;
+    }
+
+    // a convex quad leading out of cell, corners in order around it; portals of a cell must be
+    // added right after the cell, before the next addCell()
+    void addPortal(uint32_t cell, const glm::vec3* corners)
+    {
+        Portal portal;
+        for (int i = 0; i < 4; i++)
+            portal.corners[i] = corners[i];
+        portal.cell = cell;
+        portal.target = NONE;
+        glm::vec3 center = 0.25f * (corners[0] + corners[1] + corners[2] + corners[3]);
+        glm::vec3 normal = glm::normalize(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+        // outwards: away from the middle of its cell
+        glm::vec3 cellCenter = 0.5f * (cells[cell].boxMin + cells[cell].boxMax);
+        if (glm::dot(normal, center - cellCenter) < 0.0f)
+            normal = -normal;
+        portal.plane = glm::vec4(normal, -glm::dot(normal, center));
+        portals.push_back(portal);
+        cells[cell].portalCount++;
+    }
+
+    // find the cell behind each portal; call once after adding everything
+    void link()
+    {
+        bucketSize = 1e-3f;
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            glm::vec3 size = cells[i].boxMax - cells[i].boxMin;
+            bucketSize = glm::max(bucketSize, glm::max(size.x, glm::max(size.y, size.z)));
+        }
+        buckets.clear();
+        for (uint32_t i = 0; i < cells.size(); i++)
+        {
+            glm::ivec3 low = bucketOf(cells[i].boxMin), high = bucketOf(cells[i].boxMax);
+            for (int z = low.z; z <= high.z; z++)
+                for (int y = low.y; y <= high.y; y++)
+                    for (int x = low.x; x <= high.x; x++)
+                        buckets[key(glm::ivec3(x, y, z))].push_back(i);
+        }
+        for (size_t i = 0; i < portals.size(); i++)
+        {
+            Portal& portal = portals[i];
+            glm::vec3 center = 0.25f * (portal.corners[0] + portal.corners[1] + portal.corners[2] + portal.corners[3]);
+            portal.target = findCell(center + glm::vec3(portal.plane) * PORTAL_PROBE, portal.cell);
+        }
+    }
+
+    // the cell containing point other than exclude, or NONE
+    uint32_t findCell(const glm::vec3& point, uint32_t exclude = NONE) const
+    {
+        std::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator bucket = buckets.find(key(bucketOf(point)));
+        if (bucket == buckets.end())
+            return NONE;
+        for (size_t i = 0; i < bucket->second.size(); i++)
+        {
+            uint32_t c = bucket->second[i];
+            if (c == exclude)
+                continue;
+            const Cell& cell = cells[c];
+            if (point.x >= cell.boxMin.x && point.y >= cell.boxMin.y && point.z >= cell.boxMin.z
+                && point.x <= cell.boxMax.x && point.y <= cell.boxMax.y && point.z <= cell.boxMax.z)
+                return c;
+        }
+        return NONE;
+    }
+
+    // find what is visible from eye through the six frustum planes (normals inside, as
+    // Camera::GetFrustumPlanes)
+    void update(const glm::vec3& eye, const glm::vec4* frustum)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        frame++;
+        VisibleCells = 0;
+        PortalsTested = 0;
+        CameraCell = findCell(eye);
+        const glm::vec4 sides[4] = { frustum[FRUSTUM_LEFT], frustum[FRUSTUM_RIGHT], frustum[FRUSTUM_BOTTOM], frustum[FRUSTUM_TOP] };
+        const glm::vec4& farPlane = frustum[FRUSTUM_FAR];
+        if (CameraCell != NONE)
+            visit(CameraCell, eye, sides, 4, farPlane, 0);
+        else
+        {
+            // from outside, looking in through every opening to the outside
+            for (size_t i = 0; i < portals.size(); i++)
+            {
+                const Portal& portal = portals[i];
+                if (portal.target != NONE)
+                    continue;
+                PortalsTested++;
+                glm::vec4 planes[MAX_PLANES];
+                int count = 0;
+                if (distance(portal.plane, eye) > 0.0f && narrow(portal, eye, sides, 4, farPlane, planes, count))
+                    visit(portal.cell, eye, planes, count, farPlane, 1);
+            }
+        }
+        Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // cells added to a scene without any are NONE and always visible
+    bool isVisible(uint32_t cell) const
+    {
+        return cell == NONE || visibleFrame[cell] == frame;
+    }
+
+    void report() const
+    {
+        std::cout << "portal visibility: " << cells.size() << " cells, " << portals.size() << " portals; last frame "
+            << VisibleCells << " cells visible";
+        if (CameraCell == NONE)
+            std::cout << " from outside";
+        else
+            std::cout << " from cell " << CameraCell;
+        std::cout << ", " << PortalsTested << " portals tested in " << 1000.0 * Seconds << " ms" << std::endl;
+    }
+
+private:
+    // planes of a narrowed frustum: one per edge of a clipped portal (4 sides, 8 portal edges and
+    // the far plane cut at most 13 corners off it)
+    enum { MAX_PLANES = 16, MAX_POLYGON = 24 };
+
+    struct Cell
+    {
+        glm::vec3 boxMin;
+        glm::vec3 boxMax;
+        uint32_t firstPortal;
+        uint32_t portalCount;
+    };
+
+    struct Portal
+    {
+        glm::vec3 corners[4];
+        glm::vec4 plane;        // normal out of the cell
+        uint32_t cell;
+        uint32_t target;        // cell behind, NONE for the outside
+    };
+
+    // how far past a portal link() looks for the cell behind it
+    static constexpr float PORTAL_PROBE = 0.05f;
+
+    std::vector<Cell> cells;
+    std::vector<Portal> portals;
+    // uniform grid over the cells, one bucket per largest cell size
+    std::unordered_map<uint64_t, std::vector<uint32_t> > buckets;
+    float bucketSize;
+    std::vector<unsigned int> visibleFrame;
+    std::vector<unsigned char> onPath;
+    unsigned int frame;
+
+    glm::ivec3 bucketOf(const glm::vec3& p) const
+    {
+        return glm::ivec3(glm::floor(p / bucketSize));
+    }
+
+    static uint64_t key(const glm::ivec3& b)
+    {
+        return ((uint64_t)(uint32_t)(b.x + (1 << 20)) & 0x1FFFFF) << 42 | ((uint64_t)(uint32_t)(b.y + (1 << 20)) & 0x1FFFFF) << 21
+            | ((uint64_t)(uint32_t)(b.z + (1 << 20)) & 0x1FFFFF);
+    }
+
+    static float distance(const glm::vec4& plane, const glm::vec3& p)
+    {
+        return glm::dot(glm::vec3(plane), p) + plane.w;
+    }
+
+    // planes are the sides of the current frustum, farPlane the camera's far plane
+    void visit(uint32_t cell, const glm::vec3& eye, const glm::vec4* planes, int planeCount, const glm::vec4& farPlane, unsigned int depth)
+    {
+        if (visibleFrame[cell] != frame)
+        {
+            visibleFrame[cell] = frame;
+            VisibleCells++;
+        }
+        if (depth >= MaxDepth)
+            return;
+        onPath[cell] = 1;
+        const Cell& c = cells[cell];
+        for (uint32_t i = c.firstPortal; i < c.firstPortal + c.portalCount; i++)
+        {
+            const Portal& portal = portals[i];
+            // the outside, or a cell already on this line of sight
+            if (portal.target == NONE || onPath[portal.target])
+                continue;
+            PortalsTested++;
+            if (distance(portal.plane, eye) >= 0.0f)
+                continue;
+            glm::vec4 narrowed[MAX_PLANES];
+            int count = 0;
+            if (narrow(portal, eye, planes, planeCount, farPlane, narrowed, count))
+                visit(portal.target, eye, narrowed, count, farPlane, depth + 1);
+        }
+        onPath[cell] = 0;
+    }
+
+    // clip the portal by planes and farPlane; false when nothing is left, otherwise the planes
+    // through the eye and each edge of what is left (or the planes unchanged when the eye is in
+    // the portal)
+    bool narrow(const Portal& portal, const glm::vec3& eye, const glm::vec4* planes, int planeCount, const glm::vec4& farPlane, glm::vec4* out, int& outCount) const
+    {
+        glm::vec3 polygon[MAX_POLYGON], clipped[MAX_POLYGON];
+        int n = 4;
+        for (int i = 0; i < 4; i++)
+            polygon[i] = portal.corners[i];
+        for (int p = 0; p <= planeCount && n > 0; p++)
+        {
+            const glm::vec4& plane = p < planeCount ? planes[p] : farPlane;
+            int m = 0;
+            for (int i = 0; i < n && m + 2 <= MAX_POLYGON; i++)
+            {
+                const glm::vec3& a = polygon[i];
+                const glm::vec3& b = polygon[(i + 1) % n];
+                float da = distance(plane, a), db = distance(plane, b);
+                if (da >= 0.0f)
+                    clipped[m++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f))
+                    clipped[m++] = a + (b - a) * (da / (da - db));
+            }
+            n = m;
+            for (int i = 0; i < n; i++)
+                polygon[i] = clipped[i];
+        }
+        if (n < 3)
+            return false;
+
+        // standing in the portal: its edges give no planes, keep looking through the old ones
+        if (std::fabs(distance(portal.plane, eye)) < 1e-3f || n > MAX_PLANES)
+        {
+            outCount = planeCount;
+            for (int i = 0; i < planeCount; i++)
+                out[i] = planes[i];
+            return true;
+        }
+        glm::vec3 centroid(0.0f);
+        for (int i = 0; i < n; i++)
+            centroid += polygon[i];
+        centroid /= (float)n;
+        outCount = 0;
+        for (int i = 0; i < n; i++)
+        {
+            glm::vec3 normal = glm::cross(polygon[i] - eye, polygon[(i + 1) % n] - eye);
+            float length = glm::length(normal);
+            if (length < 1e-12f)
+                continue;
+            normal /= length;
+            glm::vec4 plane(normal, -glm::dot(normal, eye));
+            if (distance(plane, centroid) < 0.0f)
+                plane = -plane;
+            out[outCount++] = plane;
+        }
+        return true;
+    }
+};
+
+#endif
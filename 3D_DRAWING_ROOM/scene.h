@@ -0,0 +1,985 @@
+#pragma once
+
+//
+//  scene.h
+//  3D Object Drawing
+//
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera_collision.h"
+#include "draw_queue.h"
+#include "mesh_library.h"
+#include "object_id_pass.h"
+#include "occlusion_culler.h"
+#include "portal_visibility.h"
+#include "shader_variants.h"
+#include "transform_hierarchy.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Scene description files.
+//
+// Scenes are authored as text (see room.scene for the format) and compiled to a binary that
+// is the in-memory tables written out as they are: a header, then the prototype, part, node,
+// animation, cell and portal records and the name strings, each one flat array. Loading the
+// binary is one read per table, no parsing. The binary sits next to the text as <name>.bin
+// and carries a hash of the text, so editing the text recompiles it on the next load; without
+// the text the binary is used as it is.
+//
+// Prototypes are lists of parts (a model matrix relative to the prototype, a color and a
+// range of the cube's indices, or a mesh of the MeshLibrary by name). Nodes form the
+// hierarchy, stored parent-before-child; a node can place one prototype. Animations spin a
+// node about an axis on top of its local transform.
+//
+// Meshes are round furniture described as MeshLibrary primitives (cylinder, sphere, torus,
+// rounded box, extrusion), each with its tessellation, color and placement in the cube's box.
+// buildMeshes() generates them into the library after loading and useMeshes() points the
+// parts naming them at their index ranges, so the binary holds only the description.
+//
+// Prototypes are prefabs: every node placing the same one shares its part list, and each
+// part is recorded once for all of them (DrawQueue::drawInstanced), so a hundred chairs are
+// ten instanced draws rather than a thousand.
+//
+// Cells mark nodes as rooms for portal visibility (PortalVisibility): a box in the node's
+// space and the openings (windows, doorways) leading out of it. Nodes below a cell's node
+// are in that cell and are only recorded while it can be seen.
+
+// a piece of a prototype: one draw of the cube, or of a library mesh when mesh names one
+struct ScenePart
+{
+    glm::mat4 model;
+    glm::vec4 color;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t mesh;          // offset into Scene::Names, or Scene::NONE for the cube
+    uint32_t padding;
+};
+
+// a mesh generated from MeshPrimitives[firstPrimitive, + primitiveCount)
+struct SceneMesh
+{
+    uint32_t name;          // offset into Scene::Names
+    uint32_t firstPrimitive;
+    uint32_t primitiveCount;
+    uint32_t padding;
+};
+
+enum Scene_Mesh_Primitive {
+    MESH_CYLINDER,
+    MESH_SPHERE,
+    MESH_TORUS,
+    MESH_ROUNDED_BOX,
+    MESH_EXTRUSION
+};
+
+// one MeshLibrary primitive of a mesh, placed by model and painted in color
+struct SceneMeshPrimitive
+{
+    glm::mat4 model;
+    glm::vec3 color;
+    uint32_t kind;          // Scene_Mesh_Primitive
+    uint32_t segments;      // around the cylinder, sphere or torus, per quarter of a rounded box
+    uint32_t rings;         // of a sphere, around a torus's tube
+    float size;             // torus tube over outer radius, rounded box corner radius
+    float degrees;          // torus arc
+    uint32_t caps;          // cylinder: 1 bottom, 2 top; extrusion: 1 both ends
+    uint32_t firstPoint;    // extrusion outline OutlinePoints[firstPoint, + pointCount) in x and z
+    uint32_t pointCount;
+    uint32_t padding;
+};
+
+struct ScenePrototype
+{
+    uint32_t name;          // offset into Scene::Names
+    uint32_t firstPart;
+    uint32_t partCount;
+    uint32_t features;      // Shader_Feature mask the parts are drawn with
+};
+
+struct SceneNode
+{
+    uint32_t name;
+    int32_t parent;         // index of an earlier node, or -1
+    uint32_t prototype;     // Scene::NONE when the node draws nothing
+    uint32_t padding;
+    glm::mat4 local;
+};
+
+// a room: a box in its node's space and its portals Portals[firstPortal, + portalCount)
+struct SceneCell
+{
+    uint32_t node;
+    uint32_t firstPortal;
+    uint32_t portalCount;
+    uint32_t padding;
+    glm::vec3 boxMin;
+    glm::vec3 boxMax;
+};
+
+// an opening out of a cell: a rectangle in the cell node's space, flat along one axis
+struct ScenePortal
+{
+    glm::vec3 rectMin;
+    glm::vec3 rectMax;
+};
+
+// rotation of degreesPerSecond * t about axis, applied after the node's local transform
+struct SceneAnimation
+{
+    uint32_t node;
+    float degreesPerSecond;
+    glm::vec3 axis;
+};
+
+// a scene placed into a TransformHierarchy; Nodes[i] is the hierarchy node of scene node i
+struct SceneInstance
+{
+    std::vector<int> Nodes;
+    // scene nodes grouped by the prototype they place:
+    // ByPrototype[PrototypeStart[p] .. PrototypeStart[p + 1]) for prototype p
+    std::vector<uint32_t> ByPrototype;
+    std::vector<uint32_t> PrototypeStart;
+    // per scene node, the cell it is in or Scene::NONE
+    std::vector<uint32_t> NodeCells;
+    // world matrices of one prototype's copies, refilled by Scene::record()
+    std::vector<glm::mat4> Placements;
+};
+
+class Scene
+{
+public:
+    enum { NONE = 0xFFFFFFFFu };
+
+    std::vector<ScenePrototype> Prototypes;
+    std::vector<ScenePart> Parts;
+    std::vector<SceneNode> Nodes;
+    std::vector<SceneAnimation> Animations;
+    std::vector<SceneCell> Cells;
+    std::vector<ScenePortal> Portals;
+    std::vector<SceneMesh> Meshes;
+    std::vector<SceneMeshPrimitive> MeshPrimitives;
+    std::vector<glm::vec2> OutlinePoints;
+    std::vector<char> Names;
+    // statistics of the last load()
+    bool FromBinary;
+    double LoadSeconds;
+
+    Scene() : FromBinary(false), LoadSeconds(0.0)
+    {
+    }
+
+    void clear()
+    {
+        Prototypes.clear();
+        Parts.clear();
+        Nodes.clear();
+        Animations.clear();
+        Cells.clear();
+        Portals.clear();
+        Meshes.clear();
+        MeshPrimitives.clear();
+        OutlinePoints.clear();
+        Names.clear();
+    }
+
+    const char* name(uint32_t offset) const
+    {
+        return offset < Names.size() ? &Names[offset] : "";
+    }
+
+    // index of the node called name, or -1
+    int findNode(const char* nodeName) const
+    {
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (strcmp(name(Nodes[i].name), nodeName) == 0)
+                return (int)i;
+        return -1;
+    }
+
+    // generate the scene's meshes into the library; call after load(), before useMeshes(),
+    // false when the library has a mesh of the same name already
+    bool buildMeshes(MeshLibrary& meshes) const
+    {
+        for (size_t m = 0; m < Meshes.size(); m++)
+        {
+            const SceneMesh& mesh = Meshes[m];
+            if (meshes.find(name(mesh.name)) != MeshLibrary::NONE)
+            {
+                std::cout << "ERROR::SCENE::DUPLICATE_MESH: " << name(mesh.name) << std::endl;
+                return false;
+            }
+            meshes.begin(name(mesh.name));
+            for (uint32_t i = mesh.firstPrimitive; i < mesh.firstPrimitive + mesh.primitiveCount; i++)
+            {
+                const SceneMeshPrimitive& primitive = MeshPrimitives[i];
+                meshes.setColor(primitive.color);
+                switch (primitive.kind)
+                {
+                case MESH_CYLINDER:
+                    meshes.addCylinder(primitive.model, primitive.segments, (primitive.caps & 1) != 0, (primitive.caps & 2) != 0);
+                    break;
+                case MESH_SPHERE:
+                    meshes.addSphere(primitive.model, primitive.rings, primitive.segments);
+                    break;
+                case MESH_TORUS:
+                    meshes.addTorus(primitive.model, primitive.segments, primitive.rings, primitive.size, primitive.degrees);
+                    break;
+                case MESH_ROUNDED_BOX:
+                    meshes.addRoundedBox(primitive.model, primitive.size, primitive.segments);
+                    break;
+                case MESH_EXTRUSION:
+                    meshes.addExtrusion(primitive.model, &OutlinePoints[primitive.firstPoint], primitive.pointCount, primitive.caps != 0);
+                    break;
+                }
+            }
+            meshes.end();
+        }
+        meshes.setColor(glm::vec3(1.0f));
+        return true;
+    }
+
+    // point every part naming a mesh at its range of the library; call after buildMeshes(),
+    // false when a mesh is missing or a cube part reaches past the cube
+    bool useMeshes(const MeshLibrary& meshes)
+    {
+        bool ok = true;
+        for (size_t i = 0; i < Parts.size(); i++)
+        {
+            if (Parts[i].mesh == NONE)
+            {
+                // the cube is the library's first mesh
+                if (meshes.meshCount() == 0 || (uint64_t)Parts[i].firstIndex + Parts[i].indexCount > meshes.mesh(0).indexCount)
+                {
+                    std::cout << "ERROR::SCENE::INDICES_OUTSIDE_CUBE: part " << i << std::endl;
+                    ok = false;
+                }
+                continue;
+            }
+            uint32_t id = meshes.find(name(Parts[i].mesh));
+            if (id == MeshLibrary::NONE)
+            {
+                std::cout << "ERROR::SCENE::UNKNOWN_MESH: " << name(Parts[i].mesh) << std::endl;
+                ok = false;
+                continue;
+            }
+            Parts[i].firstIndex = meshes.mesh(id).firstIndex;
+            Parts[i].indexCount = meshes.mesh(id).indexCount;
+        }
+        return ok;
+    }
+
+    // nodes placing prototype from place prototype to instead (to compare two versions of a
+    // prefab); call before instantiate()
+    bool replacePrototype(const char* from, const char* to)
+    {
+        uint32_t a = findPrototype(from), b = findPrototype(to);
+        if (a == NONE || b == NONE)
+            return false;
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].prototype == a)
+                Nodes[i].prototype = b;
+        return true;
+    }
+
+    // draws one instance of the scene records, before culling
+    size_t placedParts() const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].prototype != NONE)
+                count += Prototypes[Nodes[i].prototype].partCount;
+        return count;
+    }
+
+    // load the text scene at path through its compiled binary, see the top of this file
+    bool load(const char* path)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string text;
+        bool haveText = readText(path, text);
+        uint64_t hash = haveText ? hashText(text) : 0;
+        std::string binaryPath = std::string(path) + ".bin";
+
+        if (readBinary(binaryPath.c_str(), haveText, hash))
+            FromBinary = true;
+        else if (!haveText)
+        {
+            std::cout << "ERROR::SCENE::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        else
+        {
+            if (!parse(text, path))
+                return false;
+            writeBinary(binaryPath.c_str(), hash);
+            FromBinary = false;
+        }
+        LoadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    // compile scene text into the tables; errors name the source and line
+    bool parse(const std::string& text, const char* source)
+    {
+        clear();
+        std::istringstream lines(text);
+        std::string line;
+        std::vector<std::string> tokens;
+        int number = 0;
+        bool inPrototype = false;
+        bool inMesh = false;
+        glm::vec4 color(1.0f);
+        while (std::getline(lines, line))
+        {
+            number++;
+            tokenize(line, tokens);
+            if (tokens.empty())
+                continue;
+            const std::string& keyword = tokens[0];
+            bool ok = true;
+            if (inMesh && keyword != "end" && keyword != "color")
+                ok = parsePrimitive(tokens, color);
+            else if (keyword == "mesh")
+            {
+                ok = !inPrototype && !inMesh && tokens.size() == 2 && findMesh(tokens[1]) == NONE;
+                if (ok)
+                {
+                    SceneMesh mesh = { addName(tokens[1]), (uint32_t)MeshPrimitives.size(), 0, 0 };
+                    Meshes.push_back(mesh);
+                    color = glm::vec4(1.0f);
+                    inMesh = true;
+                }
+            }
+            else if (keyword == "prototype")
+            {
+                ok = !inPrototype && !inMesh && (tokens.size() == 3 || (tokens.size() == 4 && tokens[3] == "colored"))
+                    && (tokens[2] == "lit" || tokens[2] == "flat") && findPrototype(tokens[1]) == NONE;
+                if (ok)
+                {
+                    uint32_t features = (tokens[2] == "lit" ? (uint32_t)SHADER_LIGHTING : 0u) | (tokens.size() == 4 ? (uint32_t)SHADER_VERTEX_COLOR : 0u);
+                    ScenePrototype prototype = { addName(tokens[1]), (uint32_t)Parts.size(), 0, features };
+                    Prototypes.push_back(prototype);
+                    color = glm::vec4(1.0f);
+                    inPrototype = true;
+                }
+            }
+            else if (keyword == "end")
+            {
+                ok = (inPrototype || inMesh) && tokens.size() == 1;
+                inPrototype = false;
+                inMesh = false;
+            }
+            else if (keyword == "color")
+            {
+                ok = (inPrototype || inMesh) && (tokens.size() == 4 || tokens.size() == 5);
+                color.w = 1.0f;
+                for (size_t i = 1; ok && i < tokens.size(); i++)
+                    ok = toFloat(tokens[i], color[(int)i - 1]);
+            }
+            else if (keyword == "part")
+            {
+                ScenePart part = { glm::mat4(1.0f), color, 0, CUBE_INDICES, NONE, 0 };
+                size_t next = 1;
+                ok = inPrototype;
+                if (ok && tokens.size() > 1 && tokens[1] == "indices")
+                {
+                    ok = tokens.size() >= 4 && toUint(tokens[2], part.firstIndex) && toUint(tokens[3], part.indexCount)
+                        && (uint64_t)part.firstIndex + part.indexCount <= CUBE_INDICES;
+                    next = 4;
+                }
+                else if (ok && tokens.size() > 1 && tokens[1] == "mesh")
+                {
+                    ok = tokens.size() >= 3;
+                    if (ok)
+                        part.mesh = addName(tokens[2]);
+                    next = 3;
+                }
+                ok = ok && parseTransform(tokens, next, part.model);
+                if (ok)
+                {
+                    Parts.push_back(part);
+                    Prototypes.back().partCount++;
+                }
+            }
+            else if (keyword == "node")
+            {
+                SceneNode node = { 0, -1, NONE, 0, glm::mat4(1.0f) };
+                ok = !inPrototype && tokens.size() >= 4 && findNode(tokens[1].c_str()) < 0;
+                if (ok && tokens[2] != "-")
+                {
+                    node.parent = findNode(tokens[2].c_str());
+                    ok = node.parent >= 0;
+                }
+                if (ok && tokens[3] != "-")
+                {
+                    node.prototype = findPrototype(tokens[3]);
+                    ok = node.prototype != NONE;
+                }
+                ok = ok && parseTransform(tokens, 4, node.local);
+                if (ok)
+                {
+                    node.name = addName(tokens[1]);
+                    Nodes.push_back(node);
+                }
+            }
+            else if (keyword == "spin")
+            {
+                SceneAnimation animation = { 0, 0.0f, glm::vec3(0.0f) };
+                int node = tokens.size() == 6 ? findNode(tokens[1].c_str()) : -1;
+                ok = !inPrototype && node >= 0 && toFloat(tokens[2], animation.axis.x) && toFloat(tokens[3], animation.axis.y)
+                    && toFloat(tokens[4], animation.axis.z) && toFloat(tokens[5], animation.degreesPerSecond) && glm::length(animation.axis) > 0.0f;
+                if (ok)
+                {
+                    animation.node = (uint32_t)node;
+                    animation.axis = glm::normalize(animation.axis);
+                    Animations.push_back(animation);
+                }
+            }
+            else if (keyword == "cell")
+            {
+                SceneCell cell = { 0, (uint32_t)Portals.size(), 0, 0, glm::vec3(0.0f), glm::vec3(0.0f) };
+                int node = tokens.size() == 8 ? findNode(tokens[1].c_str()) : -1;
+                ok = !inPrototype && node >= 0 && findCell((uint32_t)node) == NONE && parseVec3(tokens, 2, cell.boxMin)
+                    && parseVec3(tokens, 5, cell.boxMax);
+                if (ok)
+                {
+                    cell.node = (uint32_t)node;
+                    Cells.push_back(cell);
+                }
+            }
+            else if (keyword == "portal")
+            {
+                ScenePortal portal = { glm::vec3(0.0f), glm::vec3(0.0f) };
+                ok = !inPrototype && !Cells.empty() && tokens.size() == 7 && parseVec3(tokens, 1, portal.rectMin) && parseVec3(tokens, 4, portal.rectMax)
+                    && flatAxis(portal) >= 0;
+                if (ok)
+                {
+                    Portals.push_back(portal);
+                    Cells.back().portalCount++;
+                }
+            }
+            else
+                ok = false;
+
+            if (!ok)
+            {
+                std::cout << "ERROR::SCENE::PARSE " << source << ":" << number << ": " << line << std::endl;
+                clear();
+                return false;
+            }
+        }
+        if (inPrototype || inMesh)
+        {
+            std::cout << "ERROR::SCENE::PARSE " << source << ": " << (inMesh ? "mesh" : "prototype") << " without end" << std::endl;
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    // add every node to hierarchy, scene roots under parent
+    SceneInstance instantiate(TransformHierarchy& hierarchy, int parent = TransformHierarchy::NO_PARENT) const
+    {
+        SceneInstance instance;
+        instance.Nodes.resize(Nodes.size());
+        hierarchy.reserve(hierarchy.size() + Nodes.size());
+        for (size_t i = 0; i < Nodes.size(); i++)
+        {
+            int nodeParent = Nodes[i].parent < 0 ? parent : instance.Nodes[Nodes[i].parent];
+            instance.Nodes[i] = hierarchy.addNode(nodeParent, Nodes[i].local);
+        }
+
+        // counting sort of the placing nodes by prototype
+        instance.PrototypeStart.assign(Prototypes.size() + 1, 0);
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].prototype != NONE)
+                instance.PrototypeStart[Nodes[i].prototype + 1]++;
+        for (size_t p = 0; p < Prototypes.size(); p++)
+            instance.PrototypeStart[p + 1] += instance.PrototypeStart[p];
+        instance.ByPrototype.resize(instance.PrototypeStart.back());
+        std::vector<uint32_t> next(instance.PrototypeStart.begin(), instance.PrototypeStart.end() - 1);
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].prototype != NONE)
+                instance.ByPrototype[next[Nodes[i].prototype]++] = (uint32_t)i;
+
+        // a node is in its own cell, or else in its parent's
+        instance.NodeCells.assign(Nodes.size(), NONE);
+        for (size_t c = 0; c < Cells.size(); c++)
+            instance.NodeCells[Cells[c].node] = (uint32_t)c;
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (instance.NodeCells[i] == NONE && Nodes[i].parent >= 0)
+                instance.NodeCells[i] = instance.NodeCells[Nodes[i].parent];
+        return instance;
+    }
+
+    // pose the animated nodes at time seconds; hierarchy.update() picks the changes up
+    void animate(const SceneInstance& instance, double seconds, TransformHierarchy& hierarchy) const
+    {
+        for (size_t i = 0; i < Animations.size(); i++)
+        {
+            const SceneAnimation& animation = Animations[i];
+            float angle = (float)std::fmod(animation.degreesPerSecond * seconds, 360.0);
+            hierarchy.setLocal(instance.Nodes[animation.node],
+                Nodes[animation.node].local * glm::rotate(glm::mat4(1.0f), glm::radians(angle), animation.axis));
+        }
+    }
+
+    // the cells and portals in world space, cell c of the scene being cell c of visibility;
+    // call after hierarchy.update(), again whenever a cell's node moves
+    void buildVisibility(const SceneInstance& instance, const TransformHierarchy& hierarchy, PortalVisibility& visibility) const
+    {
+        visibility.clear();
+        for (size_t c = 0; c < Cells.size(); c++)
+        {
+            const SceneCell& cell = Cells[c];
+            const glm::mat4& world = hierarchy.worldMatrix(instance.Nodes[cell.node]);
+            glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+            for (int k = 0; k < 8; k++)
+            {
+                glm::vec3 corner((k & 1) ? cell.boxMax.x : cell.boxMin.x, (k & 2) ? cell.boxMax.y : cell.boxMin.y,
+                    (k & 4) ? cell.boxMax.z : cell.boxMin.z);
+                glm::vec3 p = glm::vec3(world * glm::vec4(corner, 1.0f));
+                boxMin = glm::min(boxMin, p);
+                boxMax = glm::max(boxMax, p);
+            }
+            uint32_t index = visibility.addCell(boxMin, boxMax);
+            for (uint32_t k = cell.firstPortal; k < cell.firstPortal + cell.portalCount; k++)
+            {
+                const ScenePortal& portal = Portals[k];
+                // the rectangle's corners in order around it, in the plane of its flat axis
+                int flat = flatAxis(portal), u = (flat + 1) % 3, v = (flat + 2) % 3;
+                glm::vec3 corners[4];
+                for (int n = 0; n < 4; n++)
+                {
+                    glm::vec3 corner = portal.rectMin;
+                    corner[u] = (n == 1 || n == 2) ? portal.rectMax[u] : portal.rectMin[u];
+                    corner[v] = n >= 2 ? portal.rectMax[v] : portal.rectMin[v];
+                    corners[n] = glm::vec3(world * glm::vec4(corner, 1.0f));
+                }
+                visibility.addPortal(index, corners);
+            }
+        }
+        visibility.link();
+    }
+
+    // record every prototype part once, instanced over all nodes placing the prototype; with
+    // visibility, nodes in cells it cannot see are left out
+    void record(SceneInstance& instance, const TransformHierarchy& hierarchy, DrawQueue& queue,
+        ShaderVariants& variants, unsigned int vertexArray, const PortalVisibility* visibility = nullptr) const
+    {
+        queue.bindVertexArray(vertexArray);
+        for (size_t p = 0; p < Prototypes.size(); p++)
+        {
+            uint32_t first = instance.PrototypeStart[p];
+            uint32_t last = instance.PrototypeStart[p + 1];
+            if (first == last)
+                continue;
+            instance.Placements.clear();
+            for (uint32_t i = first; i < last; i++)
+            {
+                uint32_t node = instance.ByPrototype[i];
+                if (!visibility || visibility->isVisible(instance.NodeCells[node]))
+                    instance.Placements.push_back(hierarchy.worldMatrix(instance.Nodes[node]));
+            }
+            if (instance.Placements.empty())
+                continue;
+
+            const ScenePrototype& prototype = Prototypes[p];
+            queue.use(variants, prototype.features);
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+            {
+                const ScenePart& part = Parts[k];
+                queue.setModel(part.model);
+                queue.setColor(part.color);
+                queue.drawInstanced(GL_TRIANGLES, part.indexCount, GL_UNSIGNED_INT, (const void*)(uintptr_t)(part.firstIndex * sizeof(GLuint)),
+                    instance.Placements.data(), instance.Placements.size());
+            }
+        }
+    }
+
+    // hand the culler every opaque part it finds big enough, at every node placing it; call
+    // between OcclusionCuller::begin() and rasterize(); with visibility, only from the cells it sees
+    void recordOccluders(const SceneInstance& instance, const TransformHierarchy& hierarchy, OcclusionCuller& culler,
+        const PortalVisibility* visibility = nullptr) const
+    {
+        for (size_t p = 0; p < Prototypes.size(); p++)
+        {
+            const ScenePrototype& prototype = Prototypes[p];
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+            {
+                const ScenePart& part = Parts[k];
+                if (part.color.w < 1.0f || !culler.isOccluderShape(part.model))
+                    continue;
+                for (uint32_t i = instance.PrototypeStart[p]; i < instance.PrototypeStart[p + 1]; i++)
+                {
+                    uint32_t node = instance.ByPrototype[i];
+                    if (!visibility || visibility->isVisible(instance.NodeCells[node]))
+                        culler.addOccluder(hierarchy.worldMatrix(instance.Nodes[node]) * part.model, part.firstIndex, part.indexCount);
+                }
+            }
+        }
+    }
+
+    // hand the collider every part that does not move: everything but the animated nodes and
+    // what hangs below them; call after hierarchy.update(), then CameraCollider::build()
+    void addColliders(const SceneInstance& instance, const TransformHierarchy& hierarchy, CameraCollider& collider) const
+    {
+        std::vector<unsigned char> moving(Nodes.size(), 0);
+        for (size_t a = 0; a < Animations.size(); a++)
+            moving[Animations[a].node] = 1;
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].parent >= 0 && moving[Nodes[i].parent])
+                moving[i] = 1;
+        for (size_t i = 0; i < Nodes.size(); i++)
+        {
+            if (moving[i] || Nodes[i].prototype == NONE)
+                continue;
+            const ScenePrototype& prototype = Prototypes[Nodes[i].prototype];
+            const glm::mat4& world = hierarchy.worldMatrix(instance.Nodes[i]);
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+                collider.addPart(world * Parts[k].model, Parts[k].firstIndex, Parts[k].indexCount);
+        }
+    }
+
+    // draw every part of every node placing a prototype into an id pass, node i as id i + 1;
+    // between ObjectIdPass::begin() and end(), with the scene's vertex array bound
+    void drawIds(const SceneInstance& instance, const TransformHierarchy& hierarchy, ObjectIdPass& pass) const
+    {
+        for (size_t i = 0; i < Nodes.size(); i++)
+        {
+            if (Nodes[i].prototype == NONE)
+                continue;
+            const ScenePrototype& prototype = Prototypes[Nodes[i].prototype];
+            const glm::mat4& world = hierarchy.worldMatrix(instance.Nodes[i]);
+            for (uint32_t k = prototype.firstPart; k < prototype.firstPart + prototype.partCount; k++)
+                pass.draw(world * Parts[k].model, Parts[k].firstIndex, Parts[k].indexCount, (uint32_t)i + 1);
+        }
+    }
+
+    void report(const char* path) const
+    {
+        std::cout << "scene " << path << ": " << Nodes.size() << " nodes, " << Prototypes.size() << " prototypes, "
+            << Parts.size() << " parts, " << Cells.size() << " cells, " << (FromBinary ? "binary" : "compiled from text") << " in "
+            << 1000.0 * LoadSeconds << " ms" << std::endl;
+    }
+
+private:
+    enum { MAGIC = 0x314E4353, VERSION = 4 }; // "SCN1"
+    enum { CUBE_INDICES = 36 };
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t prototypes;
+        uint32_t parts;
+        uint32_t nodes;
+        uint32_t animations;
+        uint32_t nameBytes;
+        uint32_t cells;
+        uint32_t portals;
+        uint32_t meshes;
+        uint32_t meshPrimitives;
+        uint32_t outlinePoints;
+    };
+
+    uint32_t addName(const std::string& text)
+    {
+        uint32_t offset = (uint32_t)Names.size();
+        Names.insert(Names.end(), text.begin(), text.end());
+        Names.push_back('\0');
+        return offset;
+    }
+
+    uint32_t findPrototype(const std::string& text) const
+    {
+        for (size_t i = 0; i < Prototypes.size(); i++)
+            if (text == name(Prototypes[i].name))
+                return (uint32_t)i;
+        return NONE;
+    }
+
+    uint32_t findMesh(const std::string& text) const
+    {
+        for (size_t i = 0; i < Meshes.size(); i++)
+            if (text == name(Meshes[i].name))
+                return (uint32_t)i;
+        return NONE;
+    }
+
+    // a primitive line inside mesh ... end, added to the last mesh in color:
+    //  cylinder <segments> <both|bottom|top|none>, sphere <rings> <segments>,
+    //  torus <segments> <tube segments> <tube> <degrees>, rounded_box <radius> <segments>,
+    //  extrusion <capped|open> <count> <x z> * count
+    // each followed by its transform
+    bool parsePrimitive(const std::vector<std::string>& tokens, const glm::vec4& color)
+    {
+        SceneMeshPrimitive primitive = { glm::mat4(1.0f), glm::vec3(color), 0, 0, 0, 0.0f, 360.0f, 0, 0, 0, 0 };
+        const std::string& kind = tokens[0];
+        size_t next = 0;
+        bool ok = false;
+        if (kind == "cylinder" && tokens.size() >= 3)
+        {
+            const std::string& caps = tokens[2];
+            primitive.kind = MESH_CYLINDER;
+            primitive.caps = caps == "both" ? 3 : caps == "bottom" ? 1 : caps == "top" ? 2 : 0;
+            ok = toUint(tokens[1], primitive.segments) && (caps == "both" || caps == "bottom" || caps == "top" || caps == "none");
+            next = 3;
+        }
+        else if (kind == "sphere" && tokens.size() >= 3)
+        {
+            primitive.kind = MESH_SPHERE;
+            ok = toUint(tokens[1], primitive.rings) && toUint(tokens[2], primitive.segments);
+            next = 3;
+        }
+        else if (kind == "torus" && tokens.size() >= 5)
+        {
+            primitive.kind = MESH_TORUS;
+            ok = toUint(tokens[1], primitive.segments) && toUint(tokens[2], primitive.rings) && toFloat(tokens[3], primitive.size)
+                && toFloat(tokens[4], primitive.degrees);
+            next = 5;
+        }
+        else if (kind == "rounded_box" && tokens.size() >= 3)
+        {
+            primitive.kind = MESH_ROUNDED_BOX;
+            ok = toFloat(tokens[1], primitive.size) && toUint(tokens[2], primitive.segments);
+            next = 3;
+        }
+        else if (kind == "extrusion" && tokens.size() >= 3)
+        {
+            primitive.kind = MESH_EXTRUSION;
+            primitive.caps = tokens[1] == "capped" ? 1 : 0;
+            primitive.firstPoint = (uint32_t)OutlinePoints.size();
+            ok = (tokens[1] == "capped" || tokens[1] == "open") && toUint(tokens[2], primitive.pointCount) && primitive.pointCount >= 3
+                && tokens.size() >= 3 + 2 * (size_t)primitive.pointCount;
+            for (uint32_t i = 0; ok && i < primitive.pointCount; i++)
+            {
+                glm::vec2 point;
+                ok = toFloat(tokens[3 + 2 * i], point.x) && toFloat(tokens[4 + 2 * i], point.y);
+                OutlinePoints.push_back(point);
+            }
+            next = 3 + 2 * (size_t)primitive.pointCount;
+        }
+        // a failed line fails the whole parse, which clears the tables
+        if (!ok || !parseTransform(tokens, next, primitive.model))
+            return false;
+        MeshPrimitives.push_back(primitive);
+        Meshes.back().primitiveCount++;
+        return true;
+    }
+
+    uint32_t findCell(uint32_t node) const
+    {
+        for (size_t i = 0; i < Cells.size(); i++)
+            if (Cells[i].node == node)
+                return (uint32_t)i;
+        return NONE;
+    }
+
+    // the one axis along which a portal has no extent, or -1
+    static int flatAxis(const ScenePortal& portal)
+    {
+        int flat = -1;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (portal.rectMin[axis] != portal.rectMax[axis])
+                continue;
+            if (flat >= 0)
+                return -1;
+            flat = axis;
+        }
+        return flat;
+    }
+
+    static bool parseVec3(const std::vector<std::string>& tokens, size_t first, glm::vec3& value)
+    {
+        return first + 3 <= tokens.size() && toFloat(tokens[first], value.x) && toFloat(tokens[first + 1], value.y)
+            && toFloat(tokens[first + 2], value.z);
+    }
+
+    // translate x y z / rotate degrees x y z / scale x y z, multiplied left to right
+    static bool parseTransform(const std::vector<std::string>& tokens, size_t first, glm::mat4& matrix)
+    {
+        matrix = glm::mat4(1.0f);
+        size_t i = first;
+        while (i < tokens.size())
+        {
+            const std::string& op = tokens[i];
+            size_t count = op == "rotate" ? 4 : 3;
+            float v[4];
+            if ((op != "translate" && op != "rotate" && op != "scale") || i + count >= tokens.size())
+                return false;
+            for (size_t k = 0; k < count; k++)
+                if (!toFloat(tokens[i + 1 + k], v[k]))
+                    return false;
+            if (op == "translate")
+                matrix = glm::translate(matrix, glm::vec3(v[0], v[1], v[2]));
+            else if (op == "scale")
+                matrix = glm::scale(matrix, glm::vec3(v[0], v[1], v[2]));
+            else
+                matrix = glm::rotate(matrix, glm::radians(v[0]), glm::vec3(v[1], v[2], v[3]));
+            i += 1 + count;
+        }
+        return true;
+    }
+
+    // whitespace separated words up to a '#'
+    static void tokenize(const std::string& line, std::vector<std::string>& tokens)
+    {
+        tokens.clear();
+        std::istringstream words(line.substr(0, line.find('#')));
+        std::string word;
+        while (words >> word)
+            tokens.push_back(word);
+    }
+
+    static bool toFloat(const std::string& text, float& value)
+    {
+        char* end = nullptr;
+        value = strtof(text.c_str(), &end);
+        return end != text.c_str() && *end == '\0';
+    }
+
+    static bool toUint(const std::string& text, uint32_t& value)
+    {
+        char* end = nullptr;
+        unsigned long parsed = strtoul(text.c_str(), &end, 10);
+        value = (uint32_t)parsed;
+        return end != text.c_str() && *end == '\0';
+    }
+
+    // FNV-1a
+    static uint64_t hashText(const std::string& text)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            hash ^= (unsigned char)text[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static bool readText(const char* path, std::string& text)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            text.append(buffer, read);
+        fclose(file);
+        return true;
+    }
+
+    template <typename T>
+    static bool readTable(FILE* file, std::vector<T>& table, uint32_t count)
+    {
+        table.resize(count);
+        return count == 0 || fread(table.data(), sizeof(T), count, file) == count;
+    }
+
+    template <typename T>
+    static void writeTable(FILE* file, const std::vector<T>& table)
+    {
+        if (!table.empty())
+            fwrite(table.data(), sizeof(T), table.size(), file);
+    }
+
+    // false when the file is missing, damaged, or (checkHash) compiled from other text
+    bool readBinary(const char* path, bool checkHash, uint64_t hash)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+            return false;
+        FileHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == MAGIC && header.version == VERSION
+            && (!checkHash || header.sourceHash == hash);
+        ok = ok && readTable(file, Prototypes, header.prototypes) && readTable(file, Parts, header.parts)
+            && readTable(file, Nodes, header.nodes) && readTable(file, Animations, header.animations)
+            && readTable(file, Cells, header.cells) && readTable(file, Portals, header.portals)
+            && readTable(file, Meshes, header.meshes) && readTable(file, MeshPrimitives, header.meshPrimitives)
+            && readTable(file, OutlinePoints, header.outlinePoints) && readTable(file, Names, header.nameBytes);
+        fclose(file);
+        ok = ok && validate();
+        if (!ok)
+            clear();
+        return ok;
+    }
+
+    void writeBinary(const char* path, uint64_t hash) const
+    {
+        FILE* file = fopen(path, "wb");
+        if (!file)
+        {
+            std::cout << "ERROR::SCENE::WRITE_FAILED " << path << std::endl;
+            return;
+        }
+        FileHeader header = { MAGIC, VERSION, hash, (uint32_t)Prototypes.size(), (uint32_t)Parts.size(),
+            (uint32_t)Nodes.size(), (uint32_t)Animations.size(), (uint32_t)Names.size(), (uint32_t)Cells.size(), (uint32_t)Portals.size(),
+            (uint32_t)Meshes.size(), (uint32_t)MeshPrimitives.size(), (uint32_t)OutlinePoints.size() };
+        fwrite(&header, sizeof(header), 1, file);
+        writeTable(file, Prototypes);
+        writeTable(file, Parts);
+        writeTable(file, Nodes);
+        writeTable(file, Animations);
+        writeTable(file, Cells);
+        writeTable(file, Portals);
+        writeTable(file, Meshes);
+        writeTable(file, MeshPrimitives);
+        writeTable(file, OutlinePoints);
+        writeTable(file, Names);
+        fclose(file);
+    }
+
+    // indices of a loaded binary stay inside the tables, parents before children
+    bool validate() const
+    {
+        if (!Names.empty() && Names.back() != '\0')
+            return false;
+        for (size_t i = 0; i < Prototypes.size(); i++)
+            if ((uint64_t)Prototypes[i].firstPart + Prototypes[i].partCount > Parts.size())
+                return false;
+        for (size_t i = 0; i < Nodes.size(); i++)
+            if (Nodes[i].parent < -1 || Nodes[i].parent >= (int32_t)i || (Nodes[i].prototype != NONE && Nodes[i].prototype >= Prototypes.size()))
+                return false;
+        // parts of the cube draw inside its indices; mesh parts get their range in useMeshes()
+        for (size_t i = 0; i < Parts.size(); i++)
+            if ((Parts[i].mesh != NONE && Parts[i].mesh >= Names.size())
+                || (Parts[i].mesh == NONE && (uint64_t)Parts[i].firstIndex + Parts[i].indexCount > CUBE_INDICES))
+                return false;
+        for (size_t i = 0; i < Meshes.size(); i++)
+            if (Meshes[i].name >= Names.size() || (uint64_t)Meshes[i].firstPrimitive + Meshes[i].primitiveCount > MeshPrimitives.size())
+                return false;
+        for (size_t i = 0; i < MeshPrimitives.size(); i++)
+            if (MeshPrimitives[i].kind > MESH_EXTRUSION
+                || (MeshPrimitives[i].kind == MESH_EXTRUSION && (uint64_t)MeshPrimitives[i].firstPoint + MeshPrimitives[i].pointCount > OutlinePoints.size()))
+                return false;
+        for (size_t i = 0; i < Animations.size(); i++)
+            if (Animations[i].node >= Nodes.size())
+                return false;
+        for (size_t i = 0; i < Cells.size(); i++)
+            if (Cells[i].node >= Nodes.size() || (uint64_t)Cells[i].firstPortal + Cells[i].portalCount > Portals.size())
+                return false;
+        return true;
+    }
+};
+
+#endif
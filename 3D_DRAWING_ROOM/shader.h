@@ -11,141 +11,264 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "../common/gl_state.h"
+#include "../common/program_cache.h"
+
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// a program whose compile and link were issued but not checked yet, see Shader::startProgram
+struct PendingProgram
+{
+    unsigned int program;
+    unsigned int vertex;
+    unsigned int fragment;
+};
+
 class Shader
 {
 public:
     unsigned int ID;
+    // when set, use() and the uniform setters go through this cache and skip redundant calls
+    GLStateCache* State;
     // constructor generates the shader on the fly
+    // with a cache the linked program is loaded from disk when sources and driver are unchanged
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, ProgramCache* cache = nullptr) : State(nullptr)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+        readFile(vertexPath, vertexCode);
+        readFile(fragmentPath, fragmentCode);
+        // 2. compile and link shaders (or load the linked program from the cache)
+        ID = buildProgram(vertexCode, fragmentCode, cache);
+    }
+    // wraps a program that was built elsewhere (shader variants, hot reload)
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int program = 0) : ID(program), State(nullptr)
+    {
+    }
+    // reads a whole shader file, false when it could not be read
+    // ------------------------------------------------------------------------
+    static bool readFile(const char* path, std::string& code)
+    {
+        std::ifstream shaderFile;
         // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
         try
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            shaderFile.open(path);
+            std::stringstream shaderStream;
+            shaderStream << shaderFile.rdbuf();
+            shaderFile.close();
+            code = shaderStream.str();
         }
         catch (std::ifstream::failure& e)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << " " << e.what() << std::endl;
+            return false;
         }
+        return true;
+    }
+    // compile + link, through the cache when one is given; 0 when compiling or linking failed
+    // ------------------------------------------------------------------------
+    static unsigned int buildProgram(const std::string& vertexCode, const std::string& fragmentCode, ProgramCache* cache = nullptr)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string cacheKey;
+        if (cache)
+        {
+            cacheKey = cache->makeKey(vertexCode, fragmentCode);
+            unsigned int cached = cache->load(cacheKey);
+            if (cached != 0)
+                return cached;
+        }
+        unsigned int program = finishProgram(startProgram(vertexCode, fragmentCode, cache));
+        if (cache && program != 0)
+            cache->store(cacheKey, program, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        return program;
+    }
+    // issue compile and link without asking for the result; with KHR_parallel_shader_compile the
+    // driver works on it in the background until isProgramReady() says it is done
+    // ------------------------------------------------------------------------
+    static PendingProgram startProgram(const std::string& vertexCode, const std::string& fragmentCode, const ProgramCache* cache = nullptr)
+    {
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
+        PendingProgram pending;
         // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        pending.vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pending.vertex, 1, &vShaderCode, NULL);
+        glCompileShader(pending.vertex);
         // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        pending.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pending.fragment, 1, &fShaderCode, NULL);
+        glCompileShader(pending.fragment);
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        pending.program = glCreateProgram();
+        glAttachShader(pending.program, pending.vertex);
+        glAttachShader(pending.program, pending.fragment);
+        if (cache)
+            cache->prepare(pending.program);
+        glLinkProgram(pending.program);
+        return pending;
+    }
+    // ------------------------------------------------------------------------
+    static bool isProgramReady(const PendingProgram& pending)
+    {
+#if defined(GL_KHR_parallel_shader_compile)
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            GLint done = GL_FALSE;
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &done);
+            return done == GL_TRUE;
+        }
+#endif
+        // without the extension the status queries in finishProgram() simply wait
+        return true;
+    }
+    // report errors and release the shader objects; the program, or 0 if it did not link
+    // ------------------------------------------------------------------------
+    static unsigned int finishProgram(const PendingProgram& pending)
+    {
+        checkCompileErrors(pending.vertex, "VERTEX");
+        checkCompileErrors(pending.fragment, "FRAGMENT");
+        checkCompileErrors(pending.program, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
+        glDeleteShader(pending.vertex);
+        glDeleteShader(pending.fragment);
+        GLint success;
+        glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(pending.program);
+            return 0;
+        }
+        return pending.program;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        if (State)
+            State->useProgram(ID);
+        else
+            glUseProgram(ID);
     }
     // utility uniform functions
+    // names are plain C strings so setting a uniform from a literal never builds a std::string
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setInt(name, (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(const char* name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        if (State)
+            State->uniform1i(location(name), value);
+        else
+            glUniform1i(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        if (State)
+            State->uniform1f(location(name), value);
+        else
+            glUniform1f(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (State)
+            State->uniform2fv(location(name), value);
+        else
+            glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setVec2(name, glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (State)
+            State->uniform3fv(location(name), value);
+        else
+            glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setVec3(name, glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        if (State)
+            State->uniform4fv(location(name), value);
+        else
+            glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setVec4(name, glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (State)
+            State->uniformMatrix2fv(location(name), mat);
+        else
+            glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (State)
+            State->uniformMatrix3fv(location(name), mat);
+        else
+            glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(const char* name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        if (State)
+            State->uniformMatrix4fv(location(name), mat);
+        else
+            glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
+    // ------------------------------------------------------------------------
+    void setUniformBlock(const char* name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(ID, name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // std::string overloads for names built at runtime
+    // ------------------------------------------------------------------------
+    void setBool(const std::string& name, bool value) const { setBool(name.c_str(), value); }
+    void setInt(const std::string& name, int value) const { setInt(name.c_str(), value); }
+    void setFloat(const std::string& name, float value) const { setFloat(name.c_str(), value); }
+    void setVec2(const std::string& name, const glm::vec2& value) const { setVec2(name.c_str(), value); }
+    void setVec3(const std::string& name, const glm::vec3& value) const { setVec3(name.c_str(), value); }
+    void setVec4(const std::string& name, const glm::vec4& value) const { setVec4(name.c_str(), value); }
+    void setMat2(const std::string& name, const glm::mat2& mat) const { setMat2(name.c_str(), mat); }
+    void setMat3(const std::string& name, const glm::mat3& mat) const { setMat3(name.c_str(), mat); }
+    void setMat4(const std::string& name, const glm::mat4& mat) const { setMat4(name.c_str(), mat); }
 
 private:
+    int location(const char* name) const
+    {
+        return State->uniformLocation(ID, name);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static void checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -0,0 +1,436 @@
+#pragma once
+
+//
+//  shader_reload.h
+//  3D Object Drawing
+//
+
+#ifndef SHADER_RELOAD_H
+#define SHADER_RELOAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "shader.h"
+#include "shader_variants.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Calls onChange from a background thread whenever one of the watched files is written.
+// Linux uses inotify on the containing directories (editors often save by renaming a temp
+// file over the original, which a watch on the file itself would miss); elsewhere the
+// modification time and size are polled a few times per second.
+class FileWatcher
+{
+public:
+    FileWatcher() : running(false)
+    {
+    }
+
+    ~FileWatcher()
+    {
+        stop();
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // add files before start()
+    void watch(const std::string& path)
+    {
+        files.push_back(path);
+    }
+
+    void start(std::function<void()> onChange)
+    {
+        stop();
+        callback = onChange;
+        running = true;
+        thread = std::thread(&FileWatcher::run, this);
+    }
+
+    void stop()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+    }
+
+private:
+    std::vector<std::string> files;
+    std::function<void()> callback;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    static void splitPath(const std::string& path, std::string& directory, std::string& name)
+    {
+        size_t slash = path.find_last_of("/\\");
+        directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+#ifdef __linux__
+    void run()
+    {
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+        {
+            std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+            return;
+        }
+        // one watch per directory, remember which file names we care about in each
+        std::vector<int> watches;
+        std::vector<std::string> names;
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            std::string directory, name;
+            splitPath(files[i], directory, name);
+            int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (wd < 0)
+                std::cout << "ERROR::FILE_WATCHER::WATCH_FAILED " << directory << std::endl;
+            watches.push_back(wd);
+            names.push_back(name);
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        while (running)
+        {
+            // wake up regularly so stop() never waits long
+            pollfd p = { fd, POLLIN, 0 };
+            if (poll(&p, 1, 100) <= 0)
+                continue;
+
+            bool changed = false;
+            ssize_t length;
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                for (char* at = buffer; at < buffer + length; )
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+                    for (size_t i = 0; i < watches.size(); i++)
+                        if (event->wd == watches[i] && event->len > 0 && names[i] == event->name)
+                            changed = true;
+                    at += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (changed)
+                callback();
+        }
+        close(fd);
+    }
+#else
+    struct FileStamp
+    {
+        long long time;
+        long long size;
+    };
+
+    static FileStamp stamp(const std::string& path)
+    {
+        struct stat info;
+        FileStamp s = { 0, -1 };
+        if (stat(path.c_str(), &info) == 0)
+        {
+            s.time = (long long)info.st_mtime;
+            s.size = (long long)info.st_size;
+        }
+        return s;
+    }
+
+    void run()
+    {
+        std::vector<FileStamp> stamps;
+        for (size_t i = 0; i < files.size(); i++)
+            stamps.push_back(stamp(files[i]));
+
+        while (running)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+            bool changed = false;
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                FileStamp now = stamp(files[i]);
+                if (now.time != stamps[i].time || now.size != stamps[i].size)
+                {
+                    stamps[i] = now;
+                    changed = true;
+                }
+            }
+            if (changed)
+                callback();
+        }
+    }
+#endif
+};
+
+// Rebuilds every compiled variant of a ShaderVariants whenever its source files change,
+// without ever blocking the render thread on the compiler:
+//  - with KHR_parallel_shader_compile the compiles and links are issued on the render thread
+//    and only polled for completion in later frames
+//  - otherwise a worker thread with a hidden context sharing objects with the main window
+//    compiles and links, waits for the GPU side with glFinish and hands over the program ids
+// The new programs replace the old ones in update() only if every variant linked; on errors
+// the log is printed and the old programs stay in use.
+class ShaderReloader
+{
+public:
+    std::atomic<unsigned int> Reloads;
+    std::atomic<unsigned int> Failures;
+
+    // call on the main thread with the main window's context current
+    ShaderReloader(GLFWwindow* window, ShaderVariants& variants) :
+        Reloads(0), Failures(0), variants(variants), parallel(false), requested(0), started(0), compiling(false),
+        workerWindow(nullptr), quit(false), jobPending(false), resultReady(false)
+    {
+#if defined(GL_KHR_parallel_shader_compile)
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            // let the driver use as many compiler threads as it likes
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            parallel = true;
+        }
+#endif
+        if (!parallel)
+        {
+            // hidden 1x1 window whose context shares programs with the main one; the version
+            // and profile hints used for the main window are still set
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            workerWindow = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+            if (workerWindow == nullptr)
+            {
+                std::cout << "ERROR::SHADER_RELOAD::SHARED_CONTEXT_FAILED, hot reload disabled" << std::endl;
+                return;
+            }
+            worker = std::thread(&ShaderReloader::compileLoop, this);
+        }
+
+        watcher.watch(variants.VertexPath);
+        watcher.watch(variants.FragmentPath);
+        watcher.start([this]() { requestReload(); });
+    }
+
+    ~ShaderReloader()
+    {
+        stop();
+    }
+
+    ShaderReloader(const ShaderReloader&) = delete;
+    ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+    // render thread, once per frame; true when the variants were replaced
+    bool update()
+    {
+        bool swapped = false;
+        if (compiling)
+        {
+            if (parallel)
+            {
+                bool ready = true;
+                for (size_t i = 0; i < pending.size() && ready; i++)
+                    ready = Shader::isProgramReady(pending[i]);
+                if (ready)
+                {
+                    job.programs.clear();
+                    for (size_t i = 0; i < pending.size(); i++)
+                        job.programs.push_back(Shader::finishProgram(pending[i]));
+                    compiling = false;
+                    swapped = install(job);
+                }
+            }
+            else if (resultReady)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    resultReady = false;
+                }
+                compiling = false;
+                swapped = install(job);
+            }
+        }
+
+        unsigned int latest = requested.load();
+        if (!compiling && latest != started)
+        {
+            started = latest;
+            // the variants to rebuild are decided here, where new ones get compiled
+            if (parallel)
+            {
+                job.features = variants.builtVariants();
+                if (readSources(job))
+                {
+                    pending.clear();
+                    for (size_t i = 0; i < job.features.size(); i++)
+                        pending.push_back(Shader::startProgram(ShaderVariants::injectDefines(job.vertexCode, job.features[i]),
+                            ShaderVariants::injectDefines(job.fragmentCode, job.features[i])));
+                    compiling = true;
+                }
+            }
+            else if (worker.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    job.features = variants.builtVariants();
+                    jobPending = true;
+                }
+                wake.notify_one();
+                compiling = true;
+            }
+        }
+        return swapped;
+    }
+
+    // a rebuild is waiting for update() calls to be started or finished
+    // (the worker thread wakes the main loop by itself when it is done)
+    bool busy() const
+    {
+        return requested.load() != started || (parallel && compiling);
+    }
+
+    // stops the threads and destroys the worker context; call before glfwTerminate
+    void stop()
+    {
+        watcher.stop();
+        if (worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                quit = true;
+            }
+            wake.notify_one();
+            worker.join();
+        }
+        if (workerWindow)
+        {
+            glfwDestroyWindow(workerWindow);
+            workerWindow = nullptr;
+        }
+        if (resultReady)
+        {
+            resultReady = false;
+            discard(job);
+        }
+    }
+
+private:
+    // one rebuild of every variant; programs[i] belongs to features[i]
+    struct ReloadJob
+    {
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::vector<unsigned int> features;
+        std::vector<unsigned int> programs;
+    };
+
+    ShaderVariants& variants;
+    FileWatcher watcher;
+    bool parallel;
+    // bumped by the watcher for every change; a build always uses the newest sources
+    std::atomic<unsigned int> requested;
+    // render thread state
+    unsigned int started;
+    bool compiling;
+    std::vector<PendingProgram> pending;
+    // handed to the worker under the mutex and left alone by the render thread until resultReady
+    ReloadJob job;
+    // worker thread path
+    GLFWwindow* workerWindow;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool quit;
+    bool jobPending;
+    std::atomic<bool> resultReady;
+
+    bool readSources(ReloadJob& reload) const
+    {
+        return Shader::readFile(variants.VertexPath.c_str(), reload.vertexCode) && Shader::readFile(variants.FragmentPath.c_str(), reload.fragmentCode);
+    }
+
+    // all or nothing, so the variants never mix old and new sources
+    bool install(ReloadJob& reload)
+    {
+        for (size_t i = 0; i < reload.programs.size(); i++)
+        {
+            if (reload.programs[i] == 0)
+            {
+                discard(reload);
+                Failures++;
+                return false;
+            }
+        }
+        variants.replace(reload.vertexCode, reload.fragmentCode, reload.features, reload.programs);
+        reload.programs.clear();
+        Reloads++;
+        return true;
+    }
+
+    static void discard(ReloadJob& reload)
+    {
+        for (size_t i = 0; i < reload.programs.size(); i++)
+            if (reload.programs[i] != 0)
+                glDeleteProgram(reload.programs[i]);
+        reload.programs.clear();
+    }
+
+    // watcher thread
+    void requestReload()
+    {
+        requested++;
+        // the main loop may be asleep in glfwWaitEventsTimeout
+        glfwPostEmptyEvent();
+    }
+
+    // worker thread
+    void compileLoop()
+    {
+        glfwMakeContextCurrent(workerWindow);
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return quit || jobPending; });
+                if (quit)
+                    break;
+                jobPending = false;
+            }
+            job.programs.clear();
+            if (readSources(job))
+            {
+                for (size_t i = 0; i < job.features.size(); i++)
+                    job.programs.push_back(Shader::buildProgram(ShaderVariants::injectDefines(job.vertexCode, job.features[i]),
+                        ShaderVariants::injectDefines(job.fragmentCode, job.features[i])));
+                // the render context may only use the programs once they are complete on this one
+                glFinish();
+            }
+            else
+            {
+                // unreadable file (editor mid-save): report as a failed build, the next write retries
+                job.programs.assign(job.features.size(), 0);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                resultReady = true;
+            }
+            glfwPostEmptyEvent();
+        }
+        glfwMakeContextCurrent(NULL);
+    }
+};
+
+#endif
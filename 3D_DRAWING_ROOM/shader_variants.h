@@ -0,0 +1,236 @@
+#pragma once
+
+//
+//  shader_variants.h
+//  3D Object Drawing
+//
+
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include "shader.h"
+#include "../common/program_cache.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Optional shader features. Each one is a #define the shader sources test with #ifdef;
+// a variant is identified by the bit mask of the features it was compiled with.
+enum Shader_Feature {
+    SHADER_LIGHTING = 1 << 0,       // flat diffuse lighting, face normals from screen-space derivatives
+    SHADER_VERTEX_COLOR = 1 << 1,   // color from the vertex attribute instead of the color uniform
+    SHADER_DRAW_DATA = 1 << 2       // model matrix and color fetched per draw from a buffer texture (indirect_draw.h)
+};
+
+const unsigned int SHADER_FEATURE_COUNT = 3;
+const char* const SHADER_FEATURE_NAMES[SHADER_FEATURE_COUNT] = { "LIGHTING", "VERTEX_COLOR", "DRAW_DATA" };
+
+// One vertex/fragment source pair compiled into as many programs as there are feature
+// combinations in use. A variant is only compiled when it is asked for:
+//  - prepare(features) at load time for everything the renderer is known to draw with
+//  - get(features) per draw; a variant nobody prepared is compiled on the spot (counted as
+//    a late compile, since it stalls that frame)
+// Variants live in a table indexed by the feature mask, so get() on a built variant is a
+// single lookup. Draws should ask for the fewest features they need: the floor and walls
+// take the plain variant, only furniture pays for lighting. Features in Disabled are dropped
+// from every request, so a build can switch one off without touching the scene.
+class ShaderVariants
+{
+public:
+    std::string VertexPath;
+    std::string FragmentPath;
+    // features never compiled in, even where a draw asks for them
+    unsigned int Disabled;
+    // statistics
+    unsigned int Compiled;
+    unsigned int LateCompiles;
+    double CompileSeconds;
+
+    // call with a current context; the sources are read once here
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, ProgramCache* cache = nullptr) :
+        VertexPath(vertexPath), FragmentPath(fragmentPath), Disabled(0), Compiled(0), LateCompiles(0), CompileSeconds(0.0), cache(cache), state(nullptr),
+        shaders(1 << SHADER_FEATURE_COUNT), built(1 << SHADER_FEATURE_COUNT, false), seconds(1 << SHADER_FEATURE_COUNT, 0.0)
+    {
+        Shader::readFile(vertexPath, vertexCode);
+        Shader::readFile(fragmentPath, fragmentCode);
+    }
+
+    // the features a request actually gets
+    unsigned int enabled(unsigned int features) const
+    {
+        return features & ~Disabled;
+    }
+
+    // compile a variant ahead of its first use
+    void prepare(unsigned int features)
+    {
+        features = enabled(features);
+        if (!built[features])
+            build(features);
+    }
+
+    const Shader& get(unsigned int features)
+    {
+        features = enabled(features);
+        if (!built[features])
+        {
+            LateCompiles++;
+            build(features);
+        }
+        return shaders[features];
+    }
+
+    bool isBuilt(unsigned int features) const
+    {
+        return built[features];
+    }
+
+    // feature masks of every variant compiled so far
+    std::vector<unsigned int> builtVariants() const
+    {
+        std::vector<unsigned int> variants;
+        for (unsigned int features = 0; features < built.size(); features++)
+            if (built[features])
+                variants.push_back(features);
+        return variants;
+    }
+
+    // bind a uniform block in every variant, including the ones compiled later
+    void setUniformBlock(const char* name, unsigned int binding)
+    {
+        blocks.push_back(UniformBlock{ name, binding });
+        for (unsigned int features = 0; features < shaders.size(); features++)
+            if (built[features])
+                shaders[features].setUniformBlock(name, binding);
+    }
+
+    // route every variant through a state cache (see Shader::State)
+    void trackState(GLStateCache* cache)
+    {
+        state = cache;
+        for (size_t i = 0; i < shaders.size(); i++)
+            shaders[i].State = cache;
+    }
+
+    // the #define lines for a feature mask
+    static std::string defines(unsigned int features)
+    {
+        std::string lines;
+        for (unsigned int i = 0; i < SHADER_FEATURE_COUNT; i++)
+            if (features & (1u << i))
+                lines += std::string("#define ") + SHADER_FEATURE_NAMES[i] + "\n";
+        return lines;
+    }
+
+    // GLSL wants #version first, so the defines go right after that line
+    static std::string injectDefines(const std::string& code, unsigned int features)
+    {
+        std::string lines = defines(features);
+        if (lines.empty())
+            return code;
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+            return lines + code;
+        size_t lineEnd = code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return code + "\n" + lines;
+        return code.substr(0, lineEnd + 1) + lines + code.substr(lineEnd + 1);
+    }
+
+    // install programs rebuilt from new sources (hot reload); programs[i] belongs to features[i]
+    void replace(const std::string& newVertexCode, const std::string& newFragmentCode,
+        const std::vector<unsigned int>& features, const std::vector<unsigned int>& programs)
+    {
+        vertexCode = newVertexCode;
+        fragmentCode = newFragmentCode;
+        for (size_t i = 0; i < features.size(); i++)
+        {
+            Shader& shader = shaders[features[i]];
+            if (shader.ID != 0)
+            {
+                // a new program may get the deleted one's name
+                if (state)
+                    state->forgetProgram(shader.ID);
+                glDeleteProgram(shader.ID);
+            }
+            shader.ID = programs[i];
+            built[features[i]] = true;
+            bindBlocks(shader);
+        }
+    }
+
+    void report() const
+    {
+        std::cout << "shader variants: " << Compiled << " of " << shaders.size() << " compiled in "
+            << 1000.0 * CompileSeconds << " ms, " << LateCompiles << " compiled late" << std::endl;
+        for (unsigned int features = 0; features < shaders.size(); features++)
+        {
+            if (!built[features])
+                continue;
+            std::cout << "  [" << name(features) << "] " << 1000.0 * seconds[features] << " ms"
+                << (shaders[features].ID == 0 ? " (failed)" : "") << std::endl;
+        }
+    }
+
+private:
+    struct UniformBlock
+    {
+        const char* name;
+        unsigned int binding;
+    };
+
+    ProgramCache* cache;
+    GLStateCache* state;
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::vector<Shader> shaders;
+    std::vector<bool> built;
+    std::vector<double> seconds;
+    std::vector<UniformBlock> blocks;
+
+    // a variant that fails to compile stays marked as built with ID 0, so the error is printed once
+    void build(unsigned int features)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        unsigned int program = Shader::buildProgram(injectDefines(vertexCode, features), injectDefines(fragmentCode, features), cache);
+        if (program == 0)
+            std::cout << "ERROR::SHADER_VARIANTS::BUILD_FAILED [" << name(features) << "]" << std::endl;
+        shaders[features].ID = program;
+        built[features] = true;
+        bindBlocks(shaders[features]);
+
+        seconds[features] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        CompileSeconds += seconds[features];
+        Compiled++;
+    }
+
+    void bindBlocks(const Shader& shader) const
+    {
+        if (shader.ID == 0)
+            return;
+        for (size_t i = 0; i < blocks.size(); i++)
+            shader.setUniformBlock(blocks[i].name, blocks[i].binding);
+    }
+
+    static std::string name(unsigned int features)
+    {
+        if (features == 0)
+            return "base";
+        std::string text;
+        for (unsigned int i = 0; i < SHADER_FEATURE_COUNT; i++)
+        {
+            if (!(features & (1u << i)))
+                continue;
+            if (!text.empty())
+                text += " ";
+            text += SHADER_FEATURE_NAMES[i];
+        }
+        return text;
+    }
+};
+
+#endif
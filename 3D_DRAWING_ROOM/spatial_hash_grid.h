@@ -0,0 +1,397 @@
+#pragma once
+
+//
+//  spatial_hash_grid.h
+//  3D Object Drawing
+//
+
+#ifndef SPATIAL_HASH_GRID_H
+#define SPATIAL_HASH_GRID_H
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Uniform spatial hash grid for moving objects (the fan's blades, people, carts), rebuilt from
+// scratch every frame instead of refitting a tree.
+//
+// It is a loose grid: each object goes into exactly one cell, the one holding the middle of
+// its box, and queries widen their search by the largest object half size seen since reset().
+// Cells are keyed on their integer coordinates and hashed into a power-of-two bucket table;
+// a bucket is the head of a singly linked list threaded through the objects themselves, so an
+// object costs one list link and nothing is allocated while inserting.
+//
+// insert() is lock-free: the link is pushed onto its bucket with a compare-and-swap, so any
+// number of threads can insert at once (insertAll() splits a batch over threads). Queries read
+// the grid without synchronization and must not overlap inserts. Each query reports an object
+// once: an object lives in one cell, and buckets shared by several cells are filtered by cell.
+class SpatialHashGrid
+{
+public:
+    enum { NONE = 0xFFFFFFFFu };
+
+    float CellSize;
+
+    explicit SpatialHashGrid(float cellSize = 2.0f) : CellSize(cellSize), bucketMask(0), capacity(0), largestHalfSize(0)
+    {
+    }
+
+    // empty the grid for objects with ids 0 .. objectCapacity - 1
+    void reset(size_t objectCapacity)
+    {
+        size_t bucketCount = 1024;
+        while (bucketCount < 2 * objectCapacity)
+            bucketCount *= 2;
+        if (bucketCount != bucketMask + 1 || !buckets)
+        {
+            buckets.reset(new std::atomic<uint32_t>[bucketCount]);
+            bucketMask = bucketCount - 1;
+        }
+        for (size_t i = 0; i < bucketCount; i++)
+            buckets[i].store(NONE, std::memory_order_relaxed);
+        if (objectCapacity > next.size())
+        {
+            next.resize(objectCapacity);
+            keys.resize(objectCapacity);
+            boxMin.resize(objectCapacity);
+            boxMax.resize(objectCapacity);
+        }
+        capacity = objectCapacity;
+        largestHalfSize.store(0, std::memory_order_relaxed);
+    }
+
+    size_t objectCapacity() const
+    {
+        return capacity;
+    }
+
+    // add object id with its world box; safe to call from several threads at once, but each id
+    // at most once per reset()
+    void insert(uint32_t id, const glm::vec3& min, const glm::vec3& max)
+    {
+        link(id, min, max);
+        growHalfSize(halfSizeOf(min, max));
+    }
+
+    // insert objects 0 .. count - 1 from threads (0: one per hardware thread)
+    void insertAll(const glm::vec3* mins, const glm::vec3* maxs, size_t count, unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = (unsigned int)std::min<size_t>(threads, std::max<size_t>(1, count / MIN_OBJECTS_PER_THREAD));
+        if (threads <= 1)
+        {
+            insertRange(mins, maxs, 0, count);
+            return;
+        }
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        size_t chunk = (count + threads - 1) / threads;
+        for (unsigned int t = 1; t < threads; t++)
+            workers.push_back(std::thread(&SpatialHashGrid::insertRange, this, mins, maxs, std::min(count, t * chunk),
+                std::min(count, (t + 1) * chunk)));
+        insertRange(mins, maxs, 0, std::min(count, chunk));
+        for (size_t t = 0; t < workers.size(); t++)
+            workers[t].join();
+    }
+
+    // visit(id) for every object whose box overlaps [min, max]
+    template <typename Visit>
+    void queryBox(const glm::vec3& min, const glm::vec3& max, Visit visit) const
+    {
+        float loose = halfSize();
+        glm::ivec3 low = cellOf(min - loose), high = cellOf(max + loose);
+        // a query wider than the table walks the table
+        if ((uint64_t)(high.x - low.x + 1) * (uint64_t)(high.y - low.y + 1) * (uint64_t)(high.z - low.z + 1) > bucketMask + 1)
+        {
+            for (size_t b = 0; b <= bucketMask; b++)
+                for (uint32_t id = buckets[b].load(std::memory_order_relaxed); id != NONE; id = next[id])
+                    if (overlaps(id, min, max))
+                        visit(id);
+            return;
+        }
+        for (int z = low.z; z <= high.z; z++)
+            for (int y = low.y; y <= high.y; y++)
+                for (int x = low.x; x <= high.x; x++)
+                {
+                    uint64_t key = keyOf(glm::ivec3(x, y, z));
+                    for (uint32_t id = buckets[bucketOf(key)].load(std::memory_order_relaxed); id != NONE; id = next[id])
+                        if (keys[id] == key && overlaps(id, min, max))
+                            visit(id);
+                }
+    }
+
+    // visit(id) for every object whose box comes within radius of center
+    template <typename Visit>
+    void querySphere(const glm::vec3& center, float radius, Visit visit) const
+    {
+        const float radius2 = radius * radius;
+        queryBox(center - radius, center + radius, [&](uint32_t id)
+        {
+            glm::vec3 nearest = glm::clamp(center, boxMin[id], boxMax[id]);
+            glm::vec3 d = nearest - center;
+            if (glm::dot(d, d) <= radius2)
+                visit(id);
+        });
+    }
+
+    // visit(id) for every object whose box is not outside one of the six frustum planes (normals
+    // inside, as Camera::GetFrustumPlanes); only the cells in the frustum's bounds are looked at,
+    // and whole cells are accepted or rejected at once
+    template <typename Visit>
+    void cullFrustum(const glm::vec4* planes, const glm::mat4& inverseViewProjection, Visit visit) const
+    {
+        glm::vec3 low(1e30f), high(-1e30f);
+        for (int c = 0; c < 8; c++)
+        {
+            glm::vec4 corner = inverseViewProjection * glm::vec4((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+            glm::vec3 p = glm::vec3(corner) / corner.w;
+            low = glm::min(low, p);
+            high = glm::max(high, p);
+        }
+        float loose = halfSize();
+        glm::ivec3 first = cellOf(low - loose), last = cellOf(high + loose);
+        // a frustum wider than the table walks the table
+        if ((uint64_t)(last.x - first.x + 1) * (uint64_t)(last.y - first.y + 1) * (uint64_t)(last.z - first.z + 1) > bucketMask + 1)
+        {
+            for (size_t b = 0; b <= bucketMask; b++)
+                for (uint32_t id = buckets[b].load(std::memory_order_relaxed); id != NONE; id = next[id])
+                    if (classify(planes, boxMin[id], boxMax[id]) >= 0)
+                        visit(id);
+            return;
+        }
+        for (int z = first.z; z <= last.z; z++)
+            for (int y = first.y; y <= last.y; y++)
+                for (int x = first.x; x <= last.x; x++)
+                {
+                    uint64_t key = keyOf(glm::ivec3(x, y, z));
+                    uint32_t id = buckets[bucketOf(key)].load(std::memory_order_relaxed);
+                    if (id == NONE)
+                        continue;
+                    glm::vec3 cellMin = glm::vec3((float)x, (float)y, (float)z) * CellSize;
+                    int side = classify(planes, cellMin - loose, cellMin + CellSize + loose);
+                    if (side < 0)
+                        continue;
+                    for (; id != NONE; id = next[id])
+                        if (keys[id] == key && (side > 0 || classify(planes, boxMin[id], boxMax[id]) >= 0))
+                            visit(id);
+                }
+    }
+
+    const glm::vec3& objectMin(uint32_t id) const
+    {
+        return boxMin[id];
+    }
+
+    const glm::vec3& objectMax(uint32_t id) const
+    {
+        return boxMax[id];
+    }
+
+private:
+    // fewer objects than this are not worth a thread
+    enum { MIN_OBJECTS_PER_THREAD = 16384 };
+
+    std::unique_ptr<std::atomic<uint32_t>[]> buckets;
+    size_t bucketMask;
+    size_t capacity;
+    // per object: the next object in its bucket, its cell key and its box
+    std::vector<uint32_t> next;
+    std::vector<uint64_t> keys;
+    std::vector<glm::vec3> boxMin;
+    std::vector<glm::vec3> boxMax;
+    // bits of the largest half size inserted; non-negative floats order like their bits
+    std::atomic<uint32_t> largestHalfSize;
+
+    void insertRange(const glm::vec3* mins, const glm::vec3* maxs, size_t first, size_t last)
+    {
+        float largest = 0.0f;
+        for (size_t i = first; i < last; i++)
+        {
+            link((uint32_t)i, mins[i], maxs[i]);
+            largest = std::max(largest, halfSizeOf(mins[i], maxs[i]));
+        }
+        growHalfSize(largest);
+    }
+
+    void link(uint32_t id, const glm::vec3& min, const glm::vec3& max)
+    {
+        boxMin[id] = min;
+        boxMax[id] = max;
+        uint64_t key = keyOf(cellOf(0.5f * (min + max)));
+        keys[id] = key;
+        std::atomic<uint32_t>& head = buckets[bucketOf(key)];
+        uint32_t first = head.load(std::memory_order_relaxed);
+        do
+            next[id] = first;
+        while (!head.compare_exchange_weak(first, id, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    static float halfSizeOf(const glm::vec3& min, const glm::vec3& max)
+    {
+        glm::vec3 size = max - min;
+        return 0.5f * std::max(size.x, std::max(size.y, size.z));
+    }
+
+    void growHalfSize(float half)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &half, sizeof(bits));
+        uint32_t current = largestHalfSize.load(std::memory_order_relaxed);
+        while (bits > current && !largestHalfSize.compare_exchange_weak(current, bits, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    float halfSize() const
+    {
+        uint32_t bits = largestHalfSize.load(std::memory_order_relaxed);
+        float half;
+        std::memcpy(&half, &bits, sizeof(half));
+        return half;
+    }
+
+    glm::ivec3 cellOf(const glm::vec3& p) const
+    {
+        return glm::ivec3(glm::floor(p / CellSize));
+    }
+
+    // 21 bits per axis, cells -2^20 .. 2^20 - 1
+    static uint64_t keyOf(const glm::ivec3& c)
+    {
+        return ((uint64_t)((uint32_t)c.x + (1u << 20)) & 0x1FFFFF) << 42 | ((uint64_t)((uint32_t)c.y + (1u << 20)) & 0x1FFFFF) << 21
+            | ((uint64_t)((uint32_t)c.z + (1u << 20)) & 0x1FFFFF);
+    }
+
+    size_t bucketOf(uint64_t key) const
+    {
+        key *= 0x9E3779B97F4A7C15ull;
+        return (size_t)(key >> 32) & bucketMask;
+    }
+
+    bool overlaps(uint32_t id, const glm::vec3& min, const glm::vec3& max) const
+    {
+        const glm::vec3& a = boxMin[id];
+        const glm::vec3& b = boxMax[id];
+        return a.x <= max.x && a.y <= max.y && a.z <= max.z && b.x >= min.x && b.y >= min.y && b.z >= min.z;
+    }
+
+    // -1 outside a plane, 1 inside all, 0 straddling
+    static int classify(const glm::vec4* planes, const glm::vec3& min, const glm::vec3& max)
+    {
+        int side = 1;
+        for (int p = 0; p < 6; p++)
+        {
+            glm::vec3 n(planes[p]);
+            glm::vec3 far(n.x >= 0.0f ? max.x : min.x, n.y >= 0.0f ? max.y : min.y, n.z >= 0.0f ? max.z : min.z);
+            if (glm::dot(n, far) + planes[p].w < 0.0f)
+                return -1;
+            glm::vec3 near(n.x >= 0.0f ? min.x : max.x, n.y >= 0.0f ? min.y : max.y, n.z >= 0.0f ? min.z : max.z);
+            if (glm::dot(n, near) + planes[p].w < 0.0f)
+                side = 0;
+        }
+        return side;
+    }
+};
+
+// Rebuilds a grid of 10k to 1M moving boxes (0.1 to 1 m, in a 1 km square, 2 m cells) the way
+// a frame would and times it on one thread and on all of them, then times proximity queries
+// (everything within 2 m of a camera position) and culling the boxes against a camera's view.
+// Build with ROOM_BENCH_SPATIAL_GRID defined to run it from main() instead of opening the room.
+inline void benchmarkSpatialGrid()
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const size_t counts[] = { 10000, 100000, 1000000 };
+    const unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "spatial hash grid benchmark (" << threads << " threads)" << std::endl;
+    for (size_t n : counts)
+    {
+        std::vector<glm::vec3> mins(n), maxs(n);
+        uint64_t state = 12345;
+        for (size_t i = 0; i < n; i++)
+        {
+            glm::vec3 r;
+            for (int k = 0; k < 3; k++)
+            {
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                r[k] = (float)(state >> 40) * (1.0f / 16777216.0f);
+            }
+            glm::vec3 position(1000.0f * r.x, 20.0f * r.y, 1000.0f * r.z);
+            glm::vec3 half(0.05f + 0.45f * r.y, 0.05f + 0.45f * r.z, 0.05f + 0.45f * r.x);
+            mins[i] = position - half;
+            maxs[i] = position + half;
+        }
+        SpatialHashGrid grid(2.0f);
+        const int repeats = n >= 1000000 ? 5 : 20;
+
+        double insertTime[2] = { 0.0, 0.0 };
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            // the first pass is untimed and sizes the table
+            for (int k = 0; k <= repeats; k++)
+            {
+                Clock::time_point start = Clock::now();
+                grid.reset(n);
+                grid.insertAll(mins.data(), maxs.data(), n, parallel ? threads : 1);
+                if (k > 0)
+                    insertTime[parallel] += std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+            }
+        }
+
+        // proximity: what is within 2 m of the camera, from many camera positions
+        // the eye positions are laid out before the clock starts, so only the queries are timed
+        const int queries = 100000;
+        std::vector<glm::vec3> eyes(queries);
+        for (int q = 0; q < queries; q++)
+            eyes[q] = glm::vec3(1000.0f * (q % 317) / 317.0f, 10.0f, 1000.0f * (q % 331) / 331.0f);
+        size_t found = 0;
+        Clock::time_point start = Clock::now();
+        for (int q = 0; q < queries; q++)
+            grid.querySphere(eyes[q], 2.0f, [&](uint32_t) { found++; });
+        double queryTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // culling: a walker's view across the field, 100 m deep
+        Camera camera(glm::vec3(500.0f, 1.7f, 500.0f), glm::vec3(0.0f, 1.0f, 0.0f), 30.0f, -5.0f);
+        camera.SetPerspective(camera.Aspect, camera.NearPlane, 100.0f);
+        size_t visible = 0;
+        start = Clock::now();
+        for (int k = 0; k < repeats; k++)
+        {
+            visible = 0;
+            grid.cullFrustum(camera.GetFrustumPlanes(), camera.GetInverseViewProjectionMatrix(), [&](uint32_t) { visible++; });
+        }
+        double cullTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+        size_t brute = 0;
+        const glm::vec4* planes = camera.GetFrustumPlanes();
+        for (size_t i = 0; i < n; i++)
+        {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++)
+            {
+                glm::vec3 normal(planes[p]);
+                glm::vec3 far(normal.x >= 0.0f ? maxs[i].x : mins[i].x, normal.y >= 0.0f ? maxs[i].y : mins[i].y, normal.z >= 0.0f ? maxs[i].z : mins[i].z);
+                inside = glm::dot(normal, far) + planes[p].w >= 0.0f;
+            }
+            brute += inside ? 1 : 0;
+        }
+
+        std::cout << "  " << n << " objects: rebuild " << insertTime[0] << " ms on 1 thread, " << insertTime[1] << " ms on "
+            << threads << " (" << n / insertTime[1] / 1000.0 << " M inserts/s); " << queries << " 2 m queries in " << queryTime
+            << " ms (" << queries / queryTime / 1000.0 << " M queries/s, " << (double)found / queries << " found each); cull "
+            << cullTime << " ms, " << visible << " visible (brute force " << brute << ")" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,290 @@
+#pragma once
+
+//
+//  stream_buffer.h
+//  3D Object Drawing
+//
+
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+// number of frames the CPU may run ahead of the GPU before it has to wait on a fence
+const int STREAM_FRAME_REGIONS = 3;
+
+// what allocate() could hand out
+enum Stream_Allocation_Status {
+    STREAM_MAPPED,      // write through ptr
+    STREAM_UNMAPPED,    // the range is reserved but the region could not be mapped, ptr is null
+    STREAM_FULL         // nothing reserved, the region is out of space
+};
+
+// a piece of the current frame's region: fill it with write() (or through ptr when mapped),
+// bind with (buffer, offset, size) unless status is STREAM_FULL
+struct StreamAllocation
+{
+    void* ptr;
+    GLintptr offset;
+    GLsizeiptr size;
+    Stream_Allocation_Status status;
+};
+
+// true when the loader exposes glBufferStorage (glad generated with GL_ARB_buffer_storage)
+inline bool streamBufferHasStorage()
+{
+#if defined(GL_ARB_buffer_storage)
+    return GLAD_GL_ARB_buffer_storage != 0;
+#else
+    return false;
+#endif
+}
+
+// Ring buffer for per-frame dynamic data (uniform blocks, instance attributes, vertices).
+// The buffer is split into STREAM_FRAME_REGIONS regions, one per frame in flight. Every
+// allocation inside a frame is a pointer bump in the current region.
+//
+// With ARB_buffer_storage the whole buffer is mapped once (persistent + coherent) and each
+// region is guarded by a glFenceSync, so we only ever wait if the GPU is a full ring behind.
+// Without it the buffer is orphaned whenever the ring wraps and each region is mapped
+// unsynchronized, which gives the driver the same "never touch in-flight data" guarantee.
+// If that map fails the allocations still reserve their range and write() falls back to
+// glBufferSubData.
+//
+// usage per frame:  beginFrame() -> allocate()... -> commit() -> draws -> endFrame()
+class StreamBuffer
+{
+public:
+    unsigned int ID;
+    GLenum Target;
+    GLsizeiptr RegionSize;
+    GLsizeiptr Alignment;
+    // statistics, reset by the caller whenever it likes
+    unsigned int FenceWaits;
+    GLsizeiptr PeakBytes;
+
+    StreamBuffer() : ID(0), Target(GL_ARRAY_BUFFER), RegionSize(0), Alignment(16), FenceWaits(0), PeakBytes(0),
+        persistent(false), mapped(nullptr), region(0), head(0)
+    {
+        for (int i = 0; i < STREAM_FRAME_REGIONS; i++)
+            fences[i] = 0;
+    }
+
+    // target only decides the alignment rules; the data is always mapped through GL_COPY_WRITE_BUFFER
+    // so creating or mapping never disturbs the VAO / element buffer that happens to be bound
+    StreamBuffer(GLenum target, GLsizeiptr regionSize) : StreamBuffer()
+    {
+        create(target, regionSize);
+    }
+
+    ~StreamBuffer()
+    {
+        release();
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    void create(GLenum target, GLsizeiptr regionSize)
+    {
+        release();
+        Target = target;
+        Alignment = 16;
+        if (target == GL_UNIFORM_BUFFER)
+        {
+            GLint uboAlignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+            if (uboAlignment > Alignment)
+                Alignment = uboAlignment;
+        }
+        RegionSize = alignUp(regionSize, Alignment);
+
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+#if defined(GL_ARB_buffer_storage)
+        if (streamBufferHasStorage())
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize(), NULL, flags);
+            mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize(), flags));
+            persistent = mapped != nullptr;
+            if (!persistent)
+            {
+                // storage is immutable now, so start over with a fresh name for the fallback path
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+                glDeleteBuffers(1, &ID);
+                glGenBuffers(1, &ID);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            }
+        }
+#endif
+        if (!persistent)
+            glBufferData(GL_COPY_WRITE_BUFFER, totalSize(), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        region = STREAM_FRAME_REGIONS - 1;
+        head = 0;
+    }
+
+    bool isPersistent() const
+    {
+        return persistent;
+    }
+
+    // move to the next region and make sure the GPU is done with it
+    void beginFrame()
+    {
+        region = (region + 1) % STREAM_FRAME_REGIONS;
+        head = 0;
+
+        if (persistent)
+        {
+            waitFence(region);
+            return;
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        // orphan on wrap-around: the driver hands us fresh storage and keeps the old one alive
+        // until every in-flight draw that reads it is finished
+        if (region == 0)
+            glBufferData(GL_COPY_WRITE_BUFFER, totalSize(), NULL, GL_STREAM_DRAW);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, regionOffset(), RegionSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (mapped == nullptr)
+            std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+    }
+
+    // bump-allocate size bytes from the current region; ptr is null unless status is STREAM_MAPPED
+    StreamAllocation allocate(GLsizeiptr size, GLsizeiptr alignment = 0)
+    {
+        StreamAllocation a = { nullptr, 0, size, STREAM_FULL };
+        GLsizeiptr start = alignUp(head, alignment > Alignment ? alignment : Alignment);
+        if (start + size > RegionSize)
+        {
+            std::cout << "ERROR::STREAM_BUFFER::REGION_FULL requested " << size << " bytes, "
+                << (RegionSize - head) << " left" << std::endl;
+            return a;
+        }
+        head = start + size;
+        if (head > PeakBytes)
+            PeakBytes = head;
+
+        a.offset = regionOffset() + start;
+        if (mapped == nullptr)
+        {
+            a.status = STREAM_UNMAPPED;
+            return a;
+        }
+        // the persistent mapping covers the whole buffer, the fallback mapping only this region
+        a.ptr = persistent ? mapped + a.offset : mapped + start;
+        a.status = STREAM_MAPPED;
+        return a;
+    }
+
+    // copy bytes to at bytes into an allocation: through the mapping, or glBufferSubData without one
+    void write(const StreamAllocation& a, GLintptr at, const void* data, GLsizeiptr bytes)
+    {
+        if (a.status == STREAM_FULL || at + bytes > a.size)
+            return;
+        if (a.ptr)
+        {
+            memcpy(static_cast<unsigned char*>(a.ptr) + at, data, bytes);
+            return;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, a.offset + at, bytes, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // make this frame's writes visible to GL; call after the last allocate and before the first draw
+    void commit()
+    {
+        if (persistent || mapped == nullptr)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mapped = nullptr;
+    }
+
+    // call once all draws reading this frame's region have been issued
+    void endFrame()
+    {
+        commit();
+        if (!persistent)
+            return;
+        if (fences[region])
+            glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void release()
+    {
+        for (int i = 0; i < STREAM_FRAME_REGIONS; i++)
+        {
+            if (fences[i])
+                glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+        if (ID)
+        {
+            if (mapped != nullptr)
+            {
+                glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &ID);
+        }
+        ID = 0;
+        mapped = nullptr;
+        persistent = false;
+    }
+
+private:
+    bool persistent;
+    unsigned char* mapped;
+    GLsync fences[STREAM_FRAME_REGIONS];
+    int region;
+    GLsizeiptr head;
+
+    GLsizeiptr totalSize() const
+    {
+        return RegionSize * STREAM_FRAME_REGIONS;
+    }
+
+    GLintptr regionOffset() const
+    {
+        return RegionSize * region;
+    }
+
+    static GLsizeiptr alignUp(GLsizeiptr value, GLsizeiptr alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void waitFence(int index)
+    {
+        if (!fences[index])
+            return;
+        GLenum status = glClientWaitSync(fences[index], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            // the GPU is a whole ring behind, this is the only place we ever block
+            FenceWaits++;
+            do
+            {
+                status = glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            } while (status == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fences[index]);
+        fences[index] = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,456 @@
+#pragma once
+
+//
+//  transform_batch.h
+//  3D Object Drawing
+//
+
+#ifndef TRANSFORM_BATCH_H
+#define TRANSFORM_BATCH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+// Almost every transform in the room is translate * (rotate) * scale, so the last row of the
+// 4x4 is always (0, 0, 0, 1). Affine34 keeps only the top three rows (row-major), which is
+// 25% less data to move and 36 instead of 64 multiplies per product.
+struct Affine34
+{
+    float m[3][4];
+
+    Affine34()
+    {
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 4; c++)
+                m[r][c] = (r == c) ? 1.0f : 0.0f;
+    }
+
+    static Affine34 fromMat4(const glm::mat4& mat)
+    {
+        Affine34 a;
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 4; c++)
+                a.m[r][c] = mat[c][r];
+        return a;
+    }
+
+    glm::mat4 toMat4() const
+    {
+        glm::mat4 mat(1.0f);
+        for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 4; c++)
+                mat[c][r] = m[r][c];
+        return mat;
+    }
+
+    Affine34 operator*(const Affine34& b) const
+    {
+        Affine34 out;
+        for (int r = 0; r < 3; r++)
+        {
+            for (int c = 0; c < 4; c++)
+                out.m[r][c] = m[r][0] * b.m[0][c] + m[r][1] * b.m[1][c] + m[r][2] * b.m[2][c];
+            out.m[r][3] += m[r][3];
+        }
+        return out;
+    }
+
+    glm::vec3 transformPoint(const glm::vec3& p) const
+    {
+        return glm::vec3(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+            m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+            m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+    }
+};
+
+// translation, rotation, scale, applied as T * R * S (the order the room builds its matrices in)
+struct TRS
+{
+    glm::vec3 translation;
+    glm::quat rotation;
+    glm::vec3 scale;
+
+    TRS() : translation(0.0f), rotation(1.0f, 0.0f, 0.0f, 0.0f), scale(1.0f) {}
+    TRS(const glm::vec3& t, const glm::vec3& s) : translation(t), rotation(1.0f, 0.0f, 0.0f, 0.0f), scale(s) {}
+    TRS(const glm::vec3& t, const glm::quat& r, const glm::vec3& s) : translation(t), rotation(r), scale(s) {}
+
+    Affine34 toAffine() const
+    {
+        const glm::quat& q = rotation;
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        Affine34 a;
+        a.m[0][0] = (1.0f - 2.0f * (yy + zz)) * scale.x; a.m[0][1] = 2.0f * (xy - wz) * scale.y; a.m[0][2] = 2.0f * (xz + wy) * scale.z; a.m[0][3] = translation.x;
+        a.m[1][0] = 2.0f * (xy + wz) * scale.x; a.m[1][1] = (1.0f - 2.0f * (xx + zz)) * scale.y; a.m[1][2] = 2.0f * (yz - wx) * scale.z; a.m[1][3] = translation.y;
+        a.m[2][0] = 2.0f * (xz - wy) * scale.x; a.m[2][1] = 2.0f * (yz + wx) * scale.y; a.m[2][2] = (1.0f - 2.0f * (xx + yy)) * scale.z; a.m[2][3] = translation.z;
+        return a;
+    }
+};
+
+// SoA storage of many affine transforms: M[r * 4 + c][i] is element (r, c) of transform i
+class AffineBatch
+{
+public:
+    std::vector<float> M[12];
+
+    size_t size() const
+    {
+        return M[0].size();
+    }
+
+    void resize(size_t n)
+    {
+        for (int k = 0; k < 12; k++)
+            M[k].resize(n);
+    }
+
+    void set(size_t i, const Affine34& a)
+    {
+        for (int k = 0; k < 12; k++)
+            M[k][i] = a.m[k / 4][k % 4];
+    }
+
+    Affine34 get(size_t i) const
+    {
+        Affine34 a;
+        for (int k = 0; k < 12; k++)
+            a.m[k / 4][k % 4] = M[k][i];
+        return a;
+    }
+};
+
+// SoA storage of TRS inputs: translation xyz, rotation quaternion xyzw, scale xyz
+class TRSBatch
+{
+public:
+    std::vector<float> T[3];
+    std::vector<float> R[4];
+    std::vector<float> S[3];
+
+    size_t size() const
+    {
+        return T[0].size();
+    }
+
+    void resize(size_t n)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            T[k].resize(n, 0.0f);
+            S[k].resize(n, 1.0f);
+        }
+        for (int k = 0; k < 3; k++)
+            R[k].resize(n, 0.0f);
+        R[3].resize(n, 1.0f);
+    }
+
+    void set(size_t i, const TRS& trs)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            T[k][i] = trs.translation[k];
+            S[k][i] = trs.scale[k];
+        }
+        R[0][i] = trs.rotation.x;
+        R[1][i] = trs.rotation.y;
+        R[2][i] = trs.rotation.z;
+        R[3][i] = trs.rotation.w;
+    }
+};
+
+// one SIMD register worth of floats; the kernels below are written once against this
+struct BatchScalarLane
+{
+    static const int WIDTH = 1;
+    typedef float type;
+    static type load(const float* p) { return *p; }
+    static void store(float* p, type v) { *p = v; }
+    static type set1(float f) { return f; }
+    static type add(type a, type b) { return a + b; }
+    static type sub(type a, type b) { return a - b; }
+    static type mul(type a, type b) { return a * b; }
+    static type madd(type a, type b, type c) { return a * b + c; }
+    static type min(type a, type b) { return a < b ? a : b; }
+    // per lane: c >= 0 ? a : b
+    static type selectNonNegative(type c, type a, type b) { return c >= 0.0f ? a : b; }
+    static const char* name() { return "scalar"; }
+};
+
+#if defined(__AVX2__)
+struct BatchLane
+{
+    static const int WIDTH = 8;
+    typedef __m256 type;
+    static type load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, type v) { _mm256_storeu_ps(p, v); }
+    static type set1(float f) { return _mm256_set1_ps(f); }
+    static type add(type a, type b) { return _mm256_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__) || defined(_MSC_VER)
+    static type madd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static type madd(type a, type b, type c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    static type min(type a, type b) { return _mm256_min_ps(a, b); }
+    static type selectNonNegative(type c, type a, type b) { return _mm256_blendv_ps(b, a, _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_GE_OQ)); }
+    static const char* name() { return "avx2"; }
+};
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+struct BatchLane
+{
+    static const int WIDTH = 4;
+    typedef float32x4_t type;
+    static type load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, type v) { vst1q_f32(p, v); }
+    static type set1(float f) { return vdupq_n_f32(f); }
+    static type add(type a, type b) { return vaddq_f32(a, b); }
+    static type sub(type a, type b) { return vsubq_f32(a, b); }
+    static type mul(type a, type b) { return vmulq_f32(a, b); }
+    static type madd(type a, type b, type c) { return vmlaq_f32(c, a, b); }
+    static type min(type a, type b) { return vminq_f32(a, b); }
+    static type selectNonNegative(type c, type a, type b) { return vbslq_f32(vcgeq_f32(c, vdupq_n_f32(0.0f)), a, b); }
+    static const char* name() { return "neon"; }
+};
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+struct BatchLane
+{
+    static const int WIDTH = 4;
+    typedef __m128 type;
+    static type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, type v) { _mm_storeu_ps(p, v); }
+    static type set1(float f) { return _mm_set1_ps(f); }
+    static type add(type a, type b) { return _mm_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+    static type madd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static type min(type a, type b) { return _mm_min_ps(a, b); }
+    static type selectNonNegative(type c, type a, type b)
+    {
+        type mask = _mm_cmpge_ps(c, _mm_setzero_ps());
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+    static const char* name() { return "sse2"; }
+};
+#else
+typedef BatchScalarLane BatchLane;
+#endif
+
+// kernels, templated on the lane type so the scalar tail reuses the same code
+template <typename L>
+inline void composeTRSKernel(const TRSBatch& in, AffineBatch& out, size_t i)
+{
+    typedef typename L::type V;
+    const V one = L::set1(1.0f), two = L::set1(2.0f);
+    V x = L::load(&in.R[0][i]), y = L::load(&in.R[1][i]), z = L::load(&in.R[2][i]), w = L::load(&in.R[3][i]);
+    V sx = L::load(&in.S[0][i]), sy = L::load(&in.S[1][i]), sz = L::load(&in.S[2][i]);
+    V xx = L::mul(x, x), yy = L::mul(y, y), zz = L::mul(z, z);
+    V xy = L::mul(x, y), xz = L::mul(x, z), yz = L::mul(y, z);
+    V wx = L::mul(w, x), wy = L::mul(w, y), wz = L::mul(w, z);
+
+    L::store(&out.M[0][i], L::mul(L::sub(one, L::mul(two, L::add(yy, zz))), sx));
+    L::store(&out.M[1][i], L::mul(L::mul(two, L::sub(xy, wz)), sy));
+    L::store(&out.M[2][i], L::mul(L::mul(two, L::add(xz, wy)), sz));
+    L::store(&out.M[3][i], L::load(&in.T[0][i]));
+    L::store(&out.M[4][i], L::mul(L::mul(two, L::add(xy, wz)), sx));
+    L::store(&out.M[5][i], L::mul(L::sub(one, L::mul(two, L::add(xx, zz))), sy));
+    L::store(&out.M[6][i], L::mul(L::mul(two, L::sub(yz, wx)), sz));
+    L::store(&out.M[7][i], L::load(&in.T[1][i]));
+    L::store(&out.M[8][i], L::mul(L::mul(two, L::sub(xz, wy)), sx));
+    L::store(&out.M[9][i], L::mul(L::mul(two, L::add(yz, wx)), sy));
+    L::store(&out.M[10][i], L::mul(L::sub(one, L::mul(two, L::add(xx, yy))), sz));
+    L::store(&out.M[11][i], L::load(&in.T[2][i]));
+}
+
+template <typename L>
+inline void multiplyParentKernel(const Affine34& p, const AffineBatch& b, AffineBatch& out, size_t i)
+{
+    typedef typename L::type V;
+    V b0[4], b1[4], b2[4];
+    for (int c = 0; c < 4; c++)
+    {
+        b0[c] = L::load(&b.M[c][i]);
+        b1[c] = L::load(&b.M[4 + c][i]);
+        b2[c] = L::load(&b.M[8 + c][i]);
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        V a0 = L::set1(p.m[r][0]), a1 = L::set1(p.m[r][1]), a2 = L::set1(p.m[r][2]);
+        for (int c = 0; c < 4; c++)
+        {
+            V v = L::madd(a2, b2[c], L::madd(a1, b1[c], L::mul(a0, b0[c])));
+            if (c == 3)
+                v = L::add(v, L::set1(p.m[r][3]));
+            L::store(&out.M[r * 4 + c][i], v);
+        }
+    }
+}
+
+template <typename L>
+inline void multiplyPairKernel(const AffineBatch& a, const AffineBatch& b, AffineBatch& out, size_t i)
+{
+    typedef typename L::type V;
+    V b0[4], b1[4], b2[4];
+    for (int c = 0; c < 4; c++)
+    {
+        b0[c] = L::load(&b.M[c][i]);
+        b1[c] = L::load(&b.M[4 + c][i]);
+        b2[c] = L::load(&b.M[8 + c][i]);
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        V a0 = L::load(&a.M[r * 4][i]), a1 = L::load(&a.M[r * 4 + 1][i]), a2 = L::load(&a.M[r * 4 + 2][i]);
+        V a3 = L::load(&a.M[r * 4 + 3][i]);
+        for (int c = 0; c < 4; c++)
+        {
+            V v = L::madd(a2, b2[c], L::madd(a1, b1[c], L::mul(a0, b0[c])));
+            if (c == 3)
+                v = L::add(v, a3);
+            L::store(&out.M[r * 4 + c][i], v);
+        }
+    }
+}
+
+// out[i] = compose(in[i]) for every i
+inline void batchCompose(const TRSBatch& in, AffineBatch& out)
+{
+    size_t n = in.size(), i = 0;
+    out.resize(n);
+    for (; i + BatchLane::WIDTH <= n; i += BatchLane::WIDTH)
+        composeTRSKernel<BatchLane>(in, out, i);
+    for (; i < n; i++)
+        composeTRSKernel<BatchScalarLane>(in, out, i);
+}
+
+// out[i] = parent * local[i]; the shape of every furniture part (matr * translate * scale)
+inline void batchMultiply(const Affine34& parent, const AffineBatch& local, AffineBatch& out)
+{
+    size_t n = local.size(), i = 0;
+    out.resize(n);
+    for (; i + BatchLane::WIDTH <= n; i += BatchLane::WIDTH)
+        multiplyParentKernel<BatchLane>(parent, local, out, i);
+    for (; i < n; i++)
+        multiplyParentKernel<BatchScalarLane>(parent, local, out, i);
+}
+
+// out[i] = a[i] * b[i]; a and b must hold the same number of transforms
+inline void batchMultiply(const AffineBatch& a, const AffineBatch& b, AffineBatch& out)
+{
+    if (a.size() != b.size())
+    {
+        std::cout << "ERROR::TRANSFORM_BATCH::SIZE_MISMATCH " << a.size() << " and " << b.size() << " transforms" << std::endl;
+        out.resize(0);
+        return;
+    }
+    size_t n = b.size(), i = 0;
+    out.resize(n);
+    for (; i + BatchLane::WIDTH <= n; i += BatchLane::WIDTH)
+        multiplyPairKernel<BatchLane>(a, b, out, i);
+    for (; i < n; i++)
+        multiplyPairKernel<BatchScalarLane>(a, b, out, i);
+}
+
+// GPU-ready output: 16 floats per transform, column-major (same layout as glm::mat4 / glUniformMatrix4fv)
+inline void batchToMat4(const AffineBatch& in, float* out)
+{
+    size_t n = in.size();
+    for (size_t i = 0; i < n; i++, out += 16)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            out[c * 4 + 0] = in.M[c][i];
+            out[c * 4 + 1] = in.M[4 + c][i];
+            out[c * 4 + 2] = in.M[8 + c][i];
+            out[c * 4 + 3] = (c == 3) ? 1.0f : 0.0f;
+        }
+    }
+}
+
+// compact GPU output: 12 floats per transform as three row vec4s (instance attributes or a
+// std140 array of vec4), rebuilt in the shader as transpose(mat4(row0, row1, row2, vec4(0, 0, 0, 1)))
+inline void batchToRows(const AffineBatch& in, float* out)
+{
+    size_t n = in.size();
+    for (size_t i = 0; i < n; i++, out += 12)
+        for (int k = 0; k < 12; k++)
+            out[k] = in.M[k][i];
+}
+
+// Compares the batch path (compose + parent multiply + mat4 emission) with the per-object
+// glm path the room uses (parent * translate * scale on full 4x4 matrices) for 1k..1M transforms.
+// Build with ROOM_BENCH_TRANSFORMS defined to run it from main() instead of opening the room.
+inline void benchmarkTransformBatch()
+{
+    typedef std::chrono::high_resolution_clock Clock;
+    const size_t counts[] = { 1000, 10000, 100000, 1000000 };
+    const glm::mat4 parent = glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 2.2f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.8f, 1.0f, 0.7f));
+    const Affine34 parentAffine = Affine34::fromMat4(parent);
+
+    std::cout << "transform batch benchmark (" << BatchLane::name() << ", " << BatchLane::WIDTH << " lanes)" << std::endl;
+    for (size_t n : counts)
+    {
+        std::vector<glm::vec3> t(n), s(n);
+        TRSBatch trs;
+        trs.resize(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            t[i] = glm::vec3(0.001f * (i % 997), 0.4f, 0.002f * (i % 491));
+            s[i] = glm::vec3(0.15f + 0.0001f * (i % 13), -1.0f, 0.15f);
+            trs.set(i, TRS(t[i], s[i]));
+        }
+        std::vector<glm::mat4> reference(n);
+        std::vector<float> emitted(n * 16);
+        AffineBatch local, world;
+        const int repeats = n >= 1000000 ? 3 : 20;
+
+        // untimed pass so neither side pays for first-touch page faults
+        batchCompose(trs, local);
+        batchMultiply(parentAffine, local, world);
+        batchToMat4(world, emitted.data());
+
+        Clock::time_point start = Clock::now();
+        for (int k = 0; k < repeats; k++)
+        {
+            glm::mat4 identityMatrix = glm::mat4(1.0f);
+            for (size_t i = 0; i < n; i++)
+                reference[i] = parent * glm::translate(identityMatrix, t[i]) * glm::scale(identityMatrix, s[i]);
+        }
+        double glmTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+        start = Clock::now();
+        for (int k = 0; k < repeats; k++)
+        {
+            batchCompose(trs, local);
+            batchMultiply(parentAffine, local, world);
+            batchToMat4(world, emitted.data());
+        }
+        double batchTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeats;
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < n; i++)
+            for (int c = 0; c < 4; c++)
+                for (int r = 0; r < 4; r++)
+                    maxError = glm::max(maxError, std::fabs(reference[i][c][r] - emitted[i * 16 + c * 4 + r]));
+
+        std::cout << "  " << n << " transforms: glm " << glmTime << " ms, batch " << batchTime << " ms, speedup "
+            << glmTime / batchTime << "x, max error " << maxError << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,178 @@
+#pragma once
+
+//
+//  transform_hierarchy.h
+//  3D Object Drawing
+//
+
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp>
+
+#include "transform_batch.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+// Explicit parent/child transforms for the room (furniture -> parts, fan hub -> rotor ...).
+// Every per-node field lives in its own array and nodes are stored parent-before-child, so a
+// parent's world matrix is always final before any of its children read it. Changing a local
+// transform only queues that node; update() then walks just the queued subtrees, which keeps
+// the cost proportional to what moved instead of to the size of the scene.
+class TransformHierarchy
+{
+public:
+    enum { NO_PARENT = -1 };
+
+    // node data, one entry per node, index = node id
+    std::vector<int> Parent;
+    std::vector<int> FirstChild;
+    std::vector<int> NextSibling;
+    std::vector<Affine34> Local;
+    std::vector<Affine34> World;
+    std::vector<unsigned char> Dirty;
+    std::vector<unsigned int> UpdatedFrame;
+
+    // nodes whose world transform changed in the last update(), in parent-before-child order
+    std::vector<int> Changed;
+
+    TransformHierarchy() : frame(0)
+    {
+    }
+
+    size_t size() const
+    {
+        return Parent.size();
+    }
+
+    void reserve(size_t n)
+    {
+        Parent.reserve(n);
+        FirstChild.reserve(n);
+        NextSibling.reserve(n);
+        Local.reserve(n);
+        World.reserve(n);
+        Dirty.reserve(n);
+        UpdatedFrame.reserve(n);
+    }
+
+    // the parent must already exist, which is what keeps the arrays sorted parent-before-child
+    int addNode(int parent, const Affine34& local)
+    {
+        int node = (int)Parent.size();
+        if (parent >= node)
+        {
+            std::cout << "ERROR::TRANSFORM_HIERARCHY::PARENT_AFTER_CHILD node " << node << " parent " << parent << std::endl;
+            parent = NO_PARENT;
+        }
+        Parent.push_back(parent);
+        FirstChild.push_back(NO_PARENT);
+        NextSibling.push_back(NO_PARENT);
+        Local.push_back(local);
+        World.push_back(parent == NO_PARENT ? local : World[parent] * local);
+        Dirty.push_back(0);
+        UpdatedFrame.push_back(0);
+
+        // append to the end of the sibling list so iteration follows insertion order
+        if (parent != NO_PARENT)
+        {
+            if (lastChild.size() < Parent.size())
+                lastChild.resize(Parent.size(), NO_PARENT);
+            if (lastChild[parent] == NO_PARENT)
+                FirstChild[parent] = node;
+            else
+                NextSibling[lastChild[parent]] = node;
+            lastChild[parent] = node;
+        }
+        return node;
+    }
+
+    int addNode(int parent, const glm::mat4& local)
+    {
+        return addNode(parent, Affine34::fromMat4(local));
+    }
+
+    void setLocal(int node, const Affine34& local)
+    {
+        Local[node] = local;
+        markDirty(node);
+    }
+
+    void setLocal(int node, const glm::mat4& local)
+    {
+        setLocal(node, Affine34::fromMat4(local));
+    }
+
+    void markDirty(int node)
+    {
+        if (!Dirty[node])
+        {
+            Dirty[node] = 1;
+            dirtyNodes.push_back(node);
+        }
+    }
+
+    // recompute world transforms of every queued node and its descendants
+    void update()
+    {
+        Changed.clear();
+        if (dirtyNodes.empty())
+            return;
+        frame++;
+
+        // ascending ids visit ancestors before descendants, so a subtree queued under an
+        // already-updated ancestor is skipped instead of recomputed twice
+        std::sort(dirtyNodes.begin(), dirtyNodes.end());
+        for (int root : dirtyNodes)
+        {
+            if (UpdatedFrame[root] == frame)
+                continue;
+            updateSubtree(root);
+        }
+        for (int node : dirtyNodes)
+            Dirty[node] = 0;
+        dirtyNodes.clear();
+    }
+
+    const Affine34& world(int node) const
+    {
+        return World[node];
+    }
+
+    glm::mat4 worldMatrix(int node) const
+    {
+        return World[node].toMat4();
+    }
+
+private:
+    std::vector<int> dirtyNodes;
+    std::vector<int> lastChild;
+    std::vector<int> stack;
+    unsigned int frame;
+
+    void updateSubtree(int root)
+    {
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            int node = stack.back();
+            stack.pop_back();
+
+            int parent = Parent[node];
+            World[node] = parent == NO_PARENT ? Local[node] : World[parent] * Local[node];
+            UpdatedFrame[node] = frame;
+            Changed.push_back(node);
+
+            // push children in reverse so they pop (and land in Changed) in insertion order
+            size_t first = stack.size();
+            for (int child = FirstChild[node]; child != NO_PARENT; child = NextSibling[child])
+                stack.push_back(child);
+            std::reverse(stack.begin() + first, stack.end());
+        }
+    }
+};
+
+#endif
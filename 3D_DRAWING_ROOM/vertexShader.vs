@@ -1,16 +1,51 @@
 #version 330 core
+// variant features (LIGHTING, VERTEX_COLOR, DRAW_DATA) are #defined right after #version, see shader_variants.h
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 
-out vec4 color;
-
+#ifdef VERTEX_COLOR
+out vec4 vertexColor;
+#endif
+#ifdef LIGHTING
+out vec3 worldPos;
+#endif
 
+#ifdef DRAW_DATA
+// index of this copy's data within the frame: an instanced attribute counting 0, 1, 2 ...
+// that starts at the draw's first copy (command base instance, or attribute offset on GL 3.3)
+layout (location = 2) in uint aDrawIndex;
+// 5 texels per draw starting at drawDataBase: model matrix columns, then color
+uniform samplerBuffer drawData;
+uniform int drawDataBase;
+flat out vec4 drawColor;
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+// per-frame camera data, streamed once per frame instead of set as plain uniforms
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+};
+
+// the object id pass (objectId.vs) has to land on the same pixels
+invariant gl_Position;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
-    color = vec4(aColor, 1.0f);
+#ifdef DRAW_DATA
+    int texel = drawDataBase + int(aDrawIndex) * 5;
+    mat4 model = mat4(texelFetch(drawData, texel), texelFetch(drawData, texel + 1),
+                      texelFetch(drawData, texel + 2), texelFetch(drawData, texel + 3));
+    drawColor = texelFetch(drawData, texel + 4);
+#endif
+    vec4 world = model * vec4(aPos, 1.0f);
+    gl_Position = projection * view * world;
+#ifdef VERTEX_COLOR
+    vertexColor = vec4(aColor, 1.0f);
+#endif
+#ifdef LIGHTING
+    worldPos = world.xyz;
+#endif
 }
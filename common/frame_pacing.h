@@ -0,0 +1,112 @@
+#pragma once
+
+//
+//  frame_pacing.h
+//  shared by 2D_SHIP and 3D_DRAWING_ROOM
+//
+
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Decides per loop iteration whether a frame is drawn at all, and replaces glfwPollEvents():
+//  - a frame is drawn only when something visible changed or a redraw was requested
+//    (resize, window exposed ...); otherwise the previous image simply stays on screen
+//  - after a skipped frame the thread blocks in glfwWaitEventsTimeout(): until the next
+//    simulation update if something is still moving on its own (held key, animation),
+//    or up to IdleTimeout when the scene is completely at rest
+//  - with TargetFps > 0 drawn frames are paced by sleeping instead of spinning
+//
+//  if (pacer.beginFrame(changed)) { render; swap; }
+//  pacer.waitEvents(animating, secondsUntilNextUpdate);
+class FramePacer
+{
+public:
+    // 0 = draw as fast as the swap interval allows
+    double TargetFps;
+    // longest blocking wait when nothing is going on
+    double IdleTimeout;
+    // statistics
+    unsigned long long RenderedFrames;
+    unsigned long long SkippedFrames;
+    double IdleSeconds;
+
+    FramePacer(double targetFps = 0.0, double idleTimeout = 0.5) : TargetFps(targetFps), IdleTimeout(idleTimeout),
+        RenderedFrames(0), SkippedFrames(0), IdleSeconds(0.0), redraw(true), rendered(false), frameStart(0.0)
+    {
+    }
+
+    // something outside the regular change tracking needs the next frame drawn
+    void requestRedraw()
+    {
+        redraw = true;
+    }
+
+    // true when this iteration has to render; clears the redraw request
+    bool beginFrame(bool changed)
+    {
+        rendered = changed || redraw;
+        redraw = false;
+        if (rendered)
+        {
+            RenderedFrames++;
+            frameStart = glfwGetTime();
+        }
+        else
+            SkippedFrames++;
+        return rendered;
+    }
+
+    // animating: state keeps changing without new events; untilNextUpdate: seconds until it does
+    void waitEvents(bool animating, double untilNextUpdate = 0.0)
+    {
+        if (rendered)
+        {
+            if (TargetFps > 0.0)
+                sleepUntil(frameStart + 1.0 / TargetFps);
+            glfwPollEvents();
+            return;
+        }
+        if (animating && untilNextUpdate <= 0.0)
+        {
+            glfwPollEvents();
+            return;
+        }
+
+        double start = glfwGetTime();
+        glfwWaitEventsTimeout(animating ? untilNextUpdate : IdleTimeout);
+        IdleSeconds += glfwGetTime() - start;
+    }
+
+    void report() const
+    {
+        unsigned long long total = RenderedFrames + SkippedFrames;
+        if (total == 0)
+            return;
+        std::cout << "frame pacing: " << RenderedFrames << " frames drawn, " << SkippedFrames << " skipped ("
+            << 100.0 * SkippedFrames / total << "%), " << IdleSeconds << " s waiting for events" << std::endl;
+    }
+
+private:
+    bool redraw;
+    bool rendered;
+    double frameStart;
+
+    // OS sleeps overshoot by up to a scheduler quantum: sleep most of the way, then yield
+    static void sleepUntil(double deadline)
+    {
+        const double slack = 0.002;
+        double remaining = deadline - glfwGetTime();
+        if (remaining > slack)
+            std::this_thread::sleep_for(std::chrono::duration<double>(remaining - slack));
+        while (glfwGetTime() < deadline)
+            std::this_thread::yield();
+    }
+};
+
+#endif
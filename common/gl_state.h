@@ -0,0 +1,416 @@
+#pragma once
+
+//
+//  gl_state.h
+//  shared by 2D_SHIP and 3D_DRAWING_ROOM
+//
+
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum State_Call {
+    STATE_PROGRAM,
+    STATE_VERTEX_ARRAY,
+    STATE_BUFFER,
+    STATE_UNIFORM,
+    STATE_UNIFORM_LOCATION,
+    STATE_FIXED_FUNCTION,
+    STATE_CALL_COUNT
+};
+
+// Shadow copy of the GL state the renderers touch, so calls that would not change anything
+// never reach the driver:
+//  - bound program, vertex array, array/element/uniform buffers and uniform buffer ranges
+//  - uniform values, per program and location (uniform values are program state in GL)
+//  - uniform locations, looked up once per program and name
+//  - capabilities (glEnable/glDisable), depth mask, clear color, viewport, polygon mode
+// Everything starts out unknown, so the first call of each kind always goes through.
+// Code that changes tracked state directly, or deletes a program, has to tell the cache
+// with invalidate() / forgetProgram().
+//
+// Issued[] and Filtered[] count calls per State_Call kind that reached GL or were dropped.
+class GLStateCache
+{
+public:
+    unsigned long long Issued[STATE_CALL_COUNT];
+    unsigned long long Filtered[STATE_CALL_COUNT];
+
+    GLStateCache()
+    {
+        resetCounters();
+        invalidate();
+    }
+
+    // forget everything, the next call of each kind goes through
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        arrayBuffer = UNKNOWN;
+        elementBuffer = UNKNOWN;
+        uniformBuffer = UNKNOWN;
+        for (int i = 0; i < MAX_UNIFORM_BINDINGS; i++)
+            uniformRanges[i].buffer = UNKNOWN;
+        capabilities.clear();
+        depthMaskKnown = false;
+        clearColorKnown = false;
+        viewportKnown = false;
+        polygonModeKnown = false;
+        uniforms.clear();
+        locations.clear();
+    }
+
+    // a program was deleted or relinked: drop its uniform values and locations
+    void forgetProgram(unsigned int id)
+    {
+        for (std::unordered_map<uint64_t, UniformValue>::iterator it = uniforms.begin(); it != uniforms.end(); )
+        {
+            if ((unsigned int)(it->first >> 32) == id)
+                it = uniforms.erase(it);
+            else
+                ++it;
+        }
+        for (size_t i = 0; i < locations.size(); )
+        {
+            if (locations[i].program == id)
+            {
+                locations[i] = locations.back();
+                locations.pop_back();
+            }
+            else
+                i++;
+        }
+        if (program == id)
+            program = UNKNOWN;
+    }
+
+    void useProgram(unsigned int id)
+    {
+        if (count(STATE_PROGRAM, program != id))
+        {
+            glUseProgram(id);
+            program = id;
+        }
+    }
+
+    void bindVertexArray(unsigned int id)
+    {
+        if (count(STATE_VERTEX_ARRAY, vertexArray != id))
+        {
+            glBindVertexArray(id);
+            vertexArray = id;
+            // the element buffer binding is part of the vertex array
+            elementBuffer = UNKNOWN;
+        }
+    }
+
+    // GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_UNIFORM_BUFFER are tracked, other targets pass through
+    void bindBuffer(GLenum target, unsigned int id)
+    {
+        unsigned int* bound = bufferSlot(target);
+        if (bound == nullptr || count(STATE_BUFFER, *bound != id))
+        {
+            glBindBuffer(target, id);
+            if (bound)
+                *bound = id;
+        }
+    }
+
+    void bindBufferRange(GLenum target, unsigned int index, unsigned int id, GLintptr offset, GLsizeiptr size)
+    {
+        if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS)
+        {
+            Issued[STATE_BUFFER]++;
+            glBindBufferRange(target, index, id, offset, size);
+            return;
+        }
+        BufferRange& range = uniformRanges[index];
+        if (count(STATE_BUFFER, range.buffer != id || range.offset != offset || range.size != size))
+        {
+            glBindBufferRange(target, index, id, offset, size);
+            range.buffer = id;
+            range.offset = offset;
+            range.size = size;
+            // also binds the generic GL_UNIFORM_BUFFER point
+            uniformBuffer = id;
+        }
+    }
+
+    // location of a uniform, cached per program and name
+    int uniformLocation(unsigned int id, const char* name)
+    {
+        for (size_t i = 0; i < locations.size(); i++)
+        {
+            if (locations[i].program == id && locations[i].name == name)
+            {
+                Filtered[STATE_UNIFORM_LOCATION]++;
+                return locations[i].location;
+            }
+        }
+        Issued[STATE_UNIFORM_LOCATION]++;
+        UniformLocation entry = { id, name, glGetUniformLocation(id, name) };
+        locations.push_back(entry);
+        return entry.location;
+    }
+
+    // uniforms of the current program, like glUniform*
+    void uniform1i(int location, int value)
+    {
+        if (changed(location, &value, sizeof(value)))
+            glUniform1i(location, value);
+    }
+
+    void uniform1f(int location, float value)
+    {
+        if (changed(location, &value, sizeof(value)))
+            glUniform1f(location, value);
+    }
+
+    void uniform2fv(int location, const glm::vec2& value)
+    {
+        if (changed(location, &value[0], sizeof(value)))
+            glUniform2fv(location, 1, &value[0]);
+    }
+
+    void uniform3fv(int location, const glm::vec3& value)
+    {
+        if (changed(location, &value[0], sizeof(value)))
+            glUniform3fv(location, 1, &value[0]);
+    }
+
+    void uniform4fv(int location, const glm::vec4& value)
+    {
+        if (changed(location, &value[0], sizeof(value)))
+            glUniform4fv(location, 1, &value[0]);
+    }
+
+    void uniformMatrix2fv(int location, const glm::mat2& value)
+    {
+        if (changed(location, &value[0][0], sizeof(value)))
+            glUniformMatrix2fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+
+    void uniformMatrix3fv(int location, const glm::mat3& value)
+    {
+        if (changed(location, &value[0][0], sizeof(value)))
+            glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+
+    void uniformMatrix4fv(int location, const glm::mat4& value)
+    {
+        if (changed(location, &value[0][0], sizeof(value)))
+            glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    }
+
+    void enable(GLenum capability)
+    {
+        setCapability(capability, true);
+    }
+
+    void disable(GLenum capability)
+    {
+        setCapability(capability, false);
+    }
+
+    void depthMask(bool write)
+    {
+        if (count(STATE_FIXED_FUNCTION, !depthMaskKnown || depthWrite != write))
+        {
+            glDepthMask(write ? GL_TRUE : GL_FALSE);
+            depthWrite = write;
+            depthMaskKnown = true;
+        }
+    }
+
+    void clearColor(float r, float g, float b, float a)
+    {
+        glm::vec4 color(r, g, b, a);
+        if (count(STATE_FIXED_FUNCTION, !clearColorKnown || clearColorValue != color))
+        {
+            glClearColor(r, g, b, a);
+            clearColorValue = color;
+            clearColorKnown = true;
+        }
+    }
+
+    void viewport(int x, int y, int width, int height)
+    {
+        if (count(STATE_FIXED_FUNCTION, !viewportKnown || viewportValue[0] != x || viewportValue[1] != y
+            || viewportValue[2] != width || viewportValue[3] != height))
+        {
+            glViewport(x, y, width, height);
+            viewportValue[0] = x;
+            viewportValue[1] = y;
+            viewportValue[2] = width;
+            viewportValue[3] = height;
+            viewportKnown = true;
+        }
+    }
+
+    // core profile only has GL_FRONT_AND_BACK
+    void polygonMode(GLenum mode)
+    {
+        if (count(STATE_FIXED_FUNCTION, !polygonModeKnown || polygonModeValue != mode))
+        {
+            glPolygonMode(GL_FRONT_AND_BACK, mode);
+            polygonModeValue = mode;
+            polygonModeKnown = true;
+        }
+    }
+
+    void resetCounters()
+    {
+        for (int i = 0; i < STATE_CALL_COUNT; i++)
+        {
+            Issued[i] = 0;
+            Filtered[i] = 0;
+        }
+    }
+
+    void report() const
+    {
+        static const char* const names[STATE_CALL_COUNT] = { "program", "vertex array", "buffer", "uniform", "uniform location", "fixed function" };
+        unsigned long long issued = 0, filtered = 0;
+        for (int i = 0; i < STATE_CALL_COUNT; i++)
+        {
+            issued += Issued[i];
+            filtered += Filtered[i];
+        }
+        if (issued + filtered == 0)
+            return;
+        std::cout << "gl state: " << issued << " calls issued, " << filtered << " filtered ("
+            << 100.0 * filtered / (issued + filtered) << "%)" << std::endl;
+        for (int i = 0; i < STATE_CALL_COUNT; i++)
+        {
+            if (Issued[i] + Filtered[i] == 0)
+                continue;
+            std::cout << "  " << names[i] << ": " << Issued[i] << " issued, " << Filtered[i] << " filtered" << std::endl;
+        }
+    }
+
+private:
+    // binding value for "not known", no GL object has this name
+    enum { UNKNOWN = 0xFFFFFFFFu };
+    enum { MAX_UNIFORM_BINDINGS = 16, MAX_UNIFORM_BYTES = 64 };
+
+    struct BufferRange
+    {
+        unsigned int buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    struct UniformValue
+    {
+        unsigned int size;
+        unsigned char bytes[MAX_UNIFORM_BYTES];
+    };
+
+    struct UniformLocation
+    {
+        unsigned int program;
+        std::string name;
+        int location;
+    };
+
+    struct Capability
+    {
+        GLenum name;
+        bool enabled;
+    };
+
+    unsigned int program;
+    unsigned int vertexArray;
+    unsigned int arrayBuffer;
+    unsigned int elementBuffer;
+    unsigned int uniformBuffer;
+    BufferRange uniformRanges[MAX_UNIFORM_BINDINGS];
+    std::vector<Capability> capabilities;
+    bool depthMaskKnown;
+    bool depthWrite;
+    bool clearColorKnown;
+    glm::vec4 clearColorValue;
+    bool viewportKnown;
+    int viewportValue[4];
+    bool polygonModeKnown;
+    GLenum polygonModeValue;
+    // keyed by program << 32 | location
+    std::unordered_map<uint64_t, UniformValue> uniforms;
+    std::vector<UniformLocation> locations;
+
+    // bumps the issued or filtered counter of a kind and passes the decision through
+    bool count(State_Call kind, bool issue)
+    {
+        if (issue)
+            Issued[kind]++;
+        else
+            Filtered[kind]++;
+        return issue;
+    }
+
+    unsigned int* bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER:
+            return &arrayBuffer;
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return &elementBuffer;
+        case GL_UNIFORM_BUFFER:
+            return &uniformBuffer;
+        default:
+            return nullptr;
+        }
+    }
+
+    // compares against and remembers the value last set at location of the current program;
+    // location -1 (optimized away) is silently ignored by GL, so it is filtered here
+    bool changed(int location, const void* data, unsigned int size)
+    {
+        if (location < 0 || program == UNKNOWN)
+            return count(STATE_UNIFORM, location >= 0);
+        UniformValue& value = uniforms[((uint64_t)program << 32) | (uint32_t)location];
+        if (value.size == size && memcmp(value.bytes, data, size) == 0)
+            return count(STATE_UNIFORM, false);
+        value.size = size;
+        memcpy(value.bytes, data, size);
+        return count(STATE_UNIFORM, true);
+    }
+
+    void setCapability(GLenum name, bool enabled)
+    {
+        for (size_t i = 0; i < capabilities.size(); i++)
+        {
+            if (capabilities[i].name != name)
+                continue;
+            if (count(STATE_FIXED_FUNCTION, capabilities[i].enabled != enabled))
+            {
+                if (enabled)
+                    glEnable(name);
+                else
+                    glDisable(name);
+                capabilities[i].enabled = enabled;
+            }
+            return;
+        }
+        count(STATE_FIXED_FUNCTION, true);
+        if (enabled)
+            glEnable(name);
+        else
+            glDisable(name);
+        Capability capability = { name, enabled };
+        capabilities.push_back(capability);
+    }
+};
+
+#endif
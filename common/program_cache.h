@@ -0,0 +1,226 @@
+#pragma once
+
+//
+//  program_cache.h
+//  shared by 2D_SHIP and 3D_DRAWING_ROOM
+//
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// glGetProgramBinary / glProgramBinary come with GL 4.1 or GL_ARB_get_program_binary
+#if defined(GL_VERSION_4_1) || defined(GL_ARB_get_program_binary)
+#define PROGRAM_CACHE_HAS_BINARY_API
+#endif
+
+// true when the loader exposes program binaries and the driver offers at least one format
+inline bool programCacheSupported()
+{
+    bool available = false;
+#if defined(GL_VERSION_4_1)
+    available = available || GLAD_GL_VERSION_4_1;
+#endif
+#if defined(GL_ARB_get_program_binary)
+    available = available || GLAD_GL_ARB_get_program_binary;
+#endif
+#ifdef PROGRAM_CACHE_HAS_BINARY_API
+    if (available)
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+#endif
+    return false;
+}
+
+// On-disk cache of linked programs.
+// A program is keyed by a hash of its sources, the defines it was built with and the driver's
+// vendor/renderer/version strings, so a driver update or a shader edit simply misses. Every
+// miss compiles from source as before and stores the result; a binary the driver rejects is
+// treated as a miss and overwritten.
+//
+//  unsigned int program = cache.load(key);
+//  if (program == 0) { compile; cache.prepare(program); link; cache.store(key, program, seconds); }
+class ProgramCache
+{
+public:
+    std::string Directory;
+    bool Enabled;
+    // statistics: warm = loaded from disk, cold = compiled from source
+    unsigned int Hits;
+    unsigned int Misses;
+    double HitSeconds;
+    double MissSeconds;
+
+    // call with a current context
+    ProgramCache(const char* directory = "shader_cache") : Directory(directory), Hits(0), Misses(0), HitSeconds(0.0), MissSeconds(0.0)
+    {
+        Enabled = programCacheSupported();
+        if (Enabled)
+        {
+#ifdef _WIN32
+            _mkdir(directory);
+#else
+            mkdir(directory, 0755);
+#endif
+        }
+    }
+
+    std::string makeKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines = "") const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        hashString(hash, vertexSource);
+        hashString(hash, fragmentSource);
+        hashString(hash, defines);
+        hashString(hash, glString(GL_VENDOR));
+        hashString(hash, glString(GL_RENDERER));
+        hashString(hash, glString(GL_VERSION));
+
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+        return text;
+    }
+
+    // linked program from the cache, or 0 on a miss
+    unsigned int load(const std::string& key)
+    {
+#ifdef PROGRAM_CACHE_HAS_BINARY_API
+        if (!Enabled)
+            return 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        FILE* file = fopen(path(key).c_str(), "rb");
+        if (!file)
+            return 0;
+        FileHeader header;
+        std::vector<char> binary;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == MAGIC && header.length > 0;
+        if (ok)
+        {
+            binary.resize(header.length);
+            ok = fread(binary.data(), 1, binary.size(), file) == binary.size();
+        }
+        fclose(file);
+        if (!ok)
+            return 0;
+
+        unsigned int program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            // driver changed in a way the key did not capture; compile again and overwrite
+            glDeleteProgram(program);
+            return 0;
+        }
+        Hits++;
+        HitSeconds += secondsSince(start);
+        return program;
+#else
+        return 0;
+#endif
+    }
+
+    // call between attaching the shaders and glLinkProgram so the driver keeps a retrievable binary
+    void prepare(unsigned int program) const
+    {
+#ifdef PROGRAM_CACHE_HAS_BINARY_API
+        if (Enabled)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+#endif
+    }
+
+    // write a freshly linked program; compileSeconds is what the miss cost the caller
+    void store(const std::string& key, unsigned int program, double compileSeconds)
+    {
+        Misses++;
+        MissSeconds += compileSeconds;
+#ifdef PROGRAM_CACHE_HAS_BINARY_API
+        if (!Enabled)
+            return;
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!success || length <= 0)
+            return;
+
+        std::vector<char> binary(length);
+        FileHeader header = { MAGIC, 0, 0 };
+        glGetProgramBinary(program, length, NULL, &header.format, binary.data());
+        header.length = (uint32_t)length;
+
+        FILE* file = fopen(path(key).c_str(), "wb");
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::WRITE_FAILED " << path(key) << std::endl;
+            return;
+        }
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(binary.data(), 1, binary.size(), file);
+        fclose(file);
+#endif
+    }
+
+    void report() const
+    {
+        std::cout << "program cache" << (Enabled ? "" : " (unsupported, always compiling)") << ": "
+            << Hits << " warm loads in " << 1000.0 * HitSeconds << " ms, "
+            << Misses << " cold compiles in " << 1000.0 * MissSeconds << " ms" << std::endl;
+    }
+
+private:
+    enum { MAGIC = 0x31425052 }; // "RPB1"
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        GLenum format;
+        uint32_t length;
+    };
+
+    std::string path(const std::string& key) const
+    {
+        return Directory + "/" + key + ".bin";
+    }
+
+    // FNV-1a, strings are terminated so ("ab", "c") and ("a", "bc") hash differently
+    static void hashString(uint64_t& hash, const std::string& text)
+    {
+        for (size_t i = 0; i <= text.size(); i++)
+        {
+            hash ^= (unsigned char)(i < text.size() ? text[i] : 0);
+            hash *= 1099511628211ull;
+        }
+    }
+
+    static std::string glString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    static double secondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+#endif